@@ -0,0 +1,60 @@
+/*
+ * anim_clock.c
+ * Animation time step policies, see anim_clock.h.
+ */
+
+#include "anim_clock.h"
+
+#include <string.h>
+
+void anim_clock_init(struct anim_clock *clock, enum anim_step_policy policy,
+                     double fixed_step, double max_step) {
+    *clock = (struct anim_clock){
+        .policy = policy,
+        .fixed_step = fixed_step,
+        .max_step = max_step,
+    };
+}
+
+double anim_clock_advance(struct anim_clock *clock, uint64_t frame_ns) {
+    /* Sources may switch between predicted and current time; never run backwards */
+    if (clock->last_ns == 0) clock->last_ns = frame_ns;
+    if (frame_ns < clock->last_ns) frame_ns = clock->last_ns;
+    double dt = (frame_ns - clock->last_ns) / 1e9;
+    clock->last_ns = frame_ns;
+
+    switch (clock->policy) {
+    case ANIM_STEP_VARIABLE:
+        clock->time += dt;
+        return clock->time;
+
+    case ANIM_STEP_CLAMPED:
+        clock->time += dt < clock->max_step ? dt : clock->max_step;
+        return clock->time;
+
+    case ANIM_STEP_FIXED:
+        /* Drop backlog beyond max_step instead of simulating a long stall step by step */
+        clock->accumulator += dt < clock->max_step ? dt : clock->max_step;
+        while (clock->accumulator >= clock->fixed_step) {
+            clock->prev_time = clock->time;
+            clock->time += clock->fixed_step;
+            clock->accumulator -= clock->fixed_step;
+        }
+        clock->alpha = clock->accumulator / clock->fixed_step;
+        return clock->prev_time + (clock->time - clock->prev_time) * clock->alpha;
+    }
+    return clock->time;
+}
+
+int anim_step_policy_parse(const char *name, enum anim_step_policy *policy) {
+    if (strcmp(name, "variable") == 0) {
+        *policy = ANIM_STEP_VARIABLE;
+    } else if (strcmp(name, "fixed") == 0) {
+        *policy = ANIM_STEP_FIXED;
+    } else if (strcmp(name, "clamped") == 0) {
+        *policy = ANIM_STEP_CLAMPED;
+    } else {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * anim_clock.h
+ * Animation clock: turns frame timestamps into animation time so that
+ * animation speed does not depend on how often frames are rendered.
+ *
+ * Frame timestamps are nanoseconds on any monotonic clock; the caller
+ * passes the predicted presentation time when known, "now" otherwise.
+ */
+
+#ifndef ANIM_CLOCK_H
+#define ANIM_CLOCK_H
+
+#include <stdint.h>
+
+enum anim_step_policy {
+    ANIM_STEP_VARIABLE,     /* advance by the real time between frames */
+    ANIM_STEP_FIXED,        /* simulate in fixed steps, interpolate between the last two */
+    ANIM_STEP_CLAMPED,      /* like VARIABLE, but a single step never exceeds max_step */
+};
+
+struct anim_clock {
+    enum anim_step_policy policy;
+    double fixed_step;      /* seconds per simulation step (FIXED) */
+    double max_step;        /* largest time advance per frame (CLAMPED, FIXED catch-up) */
+
+    uint64_t last_ns;       /* timestamp of the previous frame, 0 before the first */
+    double time;            /* simulated animation time, seconds */
+    double prev_time;       /* FIXED: simulated time one step earlier */
+    double accumulator;     /* FIXED: real time not yet simulated */
+    double alpha;           /* FIXED: interpolation factor between prev_time and time */
+};
+
+void anim_clock_init(struct anim_clock *clock, enum anim_step_policy policy,
+                     double fixed_step, double max_step);
+
+/* Advance to the frame at frame_ns and return the animation time to render */
+double anim_clock_advance(struct anim_clock *clock, uint64_t frame_ns);
+
+/* Parse "variable", "fixed" or "clamped"; returns -1 if unknown */
+int anim_step_policy_parse(const char *name, enum anim_step_policy *policy);
+
+#endif /* ANIM_CLOCK_H */
@@ -0,0 +1,1812 @@
+/*
+ * client.c
+ * Minimal Wayland client that creates a toplevel window using xdg-shell
+ * and renders a rotating clear color using GLES2 + EGL via wl_egl_window.
+ * Frames are paced by wl_surface.frame callbacks (eglSwapInterval 0).
+ *
+ * This variant requests server-side decorations via xdg-decoration (zxdg).
+ *
+ * Driven from a host loop through client.h; state is file-static, hence one
+ * client per process. wayland_client_demo.c is the standalone host.
+ *
+ * Build example:
+ *   gcc -o wayland-egl-demo wayland-egl-demo.c `pkg-config --cflags --libs wayland-client wayland-egl egl glesv2` -lm
+ *
+ * Generate protocol headers:
+ *   wayland-scanner client-header /usr/share/wayland-protocols/stable/xdg-shell/xdg-shell.xml xdg-shell-client-protocol.h
+ *   wayland-scanner client-header /usr/share/wayland-protocols/unstable/xdg-decoration/xdg-decoration-unstable-v1.xml xdg-decoration-unstable-v1-client-protocol.h
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include <wayland-client.h>
+#include <wayland-egl.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+
+/* Generated headers from wayland-scanner */
+#include "xdg-shell-client-protocol.h"
+#include "xdg-decoration-unstable-v1-client-protocol.h" /* for zxdg_* */
+#include "presentation-time-client-protocol.h"
+#ifdef HAVE_FIFO_V1
+#include "fifo-v1-client-protocol.h"
+#endif
+#ifdef HAVE_COMMIT_TIMING_V1
+#include "commit-timing-v1-client-protocol.h"
+#endif
+#include "tearing-control-v1-client-protocol.h"
+#include "viewporter-client-protocol.h"
+#include "single-pixel-buffer-v1-client-protocol.h"
+#include "cursor-shape-v1-client-protocol.h"
+
+#include "client.h"
+#include "present_stats.h"
+#include "frame_scheduler.h"
+#include "anim_clock.h"
+#include "frame_fences.h"
+#include "damage.h"
+#include "egl_util.h"
+#include "egl_config.h"
+#include "egl_device.h"
+#include "event_loop.h"
+#include "screenshot.h"
+#include "placeholder.h"
+#include "program_cache.h"
+#include "startup_profile.h"
+#include "cursor.h"
+
+/* Handle for the host; everything else is global (for demo simplicity) */
+struct client {
+    bool ready;                 /* more to do without waiting: host timeout 0 */
+    bool needs_flush;
+    bool latch_planned;
+    uint64_t latch_wakeup_ns;
+    uint64_t next_report_ns;
+};
+static struct client *instance = NULL;
+
+/* Globals (for demo simplicity) */
+static struct wl_display *display = NULL;
+static struct event_loop *loop = NULL;
+static struct event_source *frame_timer = NULL;   /* late-latch and content deadlines */
+static struct event_source *wakeup = NULL;        /* signal handler / dispatch thread -> loop */
+static struct wl_registry *registry = NULL;
+static struct wl_compositor *compositor = NULL;
+static struct xdg_wm_base *xdg_wm = NULL;
+
+/* decoration globals */
+static struct zxdg_decoration_manager_v1 *decoration_manager = NULL;
+static struct zxdg_toplevel_decoration_v1 *toplevel_decoration = NULL;
+
+/* presentation feedback (optional) */
+static struct wp_presentation *presentation = NULL;
+static clockid_t presentation_clock = CLOCK_MONOTONIC;
+
+/*
+ * fifo / commit-timing (optional): queue frames for specific presentation times.
+ * Built only when wayland-protocols ships them; otherwise these stay NULL
+ */
+static struct wp_fifo_manager_v1 *fifo_manager = NULL;
+static struct wp_fifo_v1 *fifo = NULL;
+static struct wp_commit_timing_manager_v1 *commit_timing_manager = NULL;
+static struct wp_commit_timer_v1 *commit_timer = NULL;
+
+/* tearing control (optional): async presentation hint */
+static struct wp_tearing_control_manager_v1 *tearing_manager = NULL;
+static struct wp_tearing_control_v1 *tearing_control = NULL;
+
+/*
+ * Outputs: refresh, size and scale of every wl_output, plus which of them
+ * the surface is on (wl_surface.enter/leave). The frame scheduler targets
+ * the refresh of current_output, the output most recently entered.
+ */
+struct output {
+    struct wl_list link;
+    struct wl_output *wl_output;
+    uint32_t global_name;
+    char name[64];
+    int32_t width, height;  /* current mode */
+    int32_t refresh_mhz;    /* current mode refresh, 0 if unknown */
+    int32_t scale;
+    bool entered;           /* surface is (partly) on this output */
+};
+static struct wl_list outputs;
+static struct output *current_output = NULL;
+
+static struct wl_surface *wl_surface = NULL;
+static struct xdg_surface *xdg_surface = NULL;
+static struct xdg_toplevel *xdg_toplevel = NULL;
+
+/* EGL / GL objects: display and context belong to the process-wide device, the rest to the window */
+static struct egl_device *egl_device = NULL;
+static struct wl_egl_window *egl_window = NULL;
+static EGLDisplay egl_display = EGL_NO_DISPLAY;
+static EGLContext egl_context = EGL_NO_CONTEXT;
+static EGLSurface egl_surface = EGL_NO_SURFACE;
+static EGLConfig egl_config = NULL;
+
+/* GPU render-ahead limit */
+static struct frame_fences fences;
+static int max_frames_in_flight = 2;
+
+/*
+ * Damage-driven redraw: content sources mark what changes in the frame being
+ * prepared, and nothing is committed while that damage is empty. With
+ * EGL_EXT_buffer_age only what is stale in the back buffer is repainted, and
+ * swap-with-damage tells the compositor which part changed.
+ */
+#define DAMAGE_HISTORY 4
+#define HEARTBEAT_SIZE 16
+#define HEARTBEAT_MARGIN 8
+static struct damage pending_damage;                /* from protocol events: resize, first frame */
+static struct damage damage_history[DAMAGE_HISTORY]; /* damage of the last frames, newest first */
+static bool animate = true;
+static bool buffer_age_supported = false;
+static PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC swap_buffers_with_damage = NULL;
+static uint64_t heartbeat_second = 0;
+
+/* The heartbeat square is drawn as a quad with a flat-color program */
+static const char *heartbeat_vertex_src =
+    "attribute vec2 position;\n"
+    "void main() {\n"
+    "    gl_Position = vec4(position, 0.0, 1.0);\n"
+    "}\n";
+static const char *heartbeat_fragment_src =
+    "precision mediump float;\n"
+    "uniform float level;\n"
+    "void main() {\n"
+    "    gl_FragColor = vec4(level, level, level, 1.0);\n"
+    "}\n";
+static struct program_cache program_cache;
+static GLuint heartbeat_program = 0;
+static GLint heartbeat_level = -1;
+static uint64_t frames_drawn = 0;
+static uint64_t idle_wakeups = 0;
+static double repaint_fraction_sum = 0.0;
+
+static int width = 640;
+static int height = 480;
+static bool fullscreen = false;
+static atomic_bool closed = false;
+
+/*
+ * Dispatch thread (--dispatch-thread): one thread owns all socket reads and
+ * dispatches the default queue, so pings and configures are answered while a
+ * frame renders. Frame callbacks and presentation feedback are created through
+ * proxy wrappers on render_queue and dispatched by the render thread, which is
+ * woken after every read. Without the option both roles share the main thread
+ * and the wrappers are the plain objects.
+ */
+static bool dispatch_thread_enabled = false;
+static pthread_t dispatch_thread;
+static struct event_loop *dispatch_loop = NULL;
+static struct event_source *dispatch_stop = NULL;
+static atomic_bool dispatch_running = false;
+static atomic_bool dispatch_failed = false;   /* connection lost; reported by client_dispatch() */
+static struct wl_event_queue *render_queue = NULL;
+static struct wl_surface *render_surface = NULL;
+static struct wp_presentation *render_presentation = NULL;
+
+/*
+ * Protocol state handed from the event handlers to the render loop, which
+ * picks it up in apply_protocol_state(). Lock-free: each value is a single
+ * atomic word, the size packed as width << 32 | height.
+ */
+static _Atomic uint64_t shared_size = (uint64_t)640 << 32 | 480;
+static atomic_bool shared_suspended = false;
+static _Atomic uint64_t shared_refresh_ns = 0;
+/* Output refresh last handed to the scheduler; feedback may refine its own value in between */
+static uint64_t applied_refresh_ns = 0;
+
+/*
+ * Configure state machine: xdg_toplevel.configure only records the requested
+ * state and xdg_surface.configure publishes the latest of a sequence with its
+ * serial. The render loop picks up only the newest configure at the start of
+ * a frame, resizes the wl_egl_window once, renders at the new size and acks
+ * the serial right before the swap, so ack and buffer arrive in one commit.
+ * Serials superseded before a frame used them are never acked (the protocol
+ * only requires acking the last one).
+ *
+ * Size and serial must be read as a pair: configure_seq is a seqlock, odd
+ * while the dispatch side writes, and advances by 2 per configure.
+ */
+static struct {
+    int32_t width, height;  /* 0: keep the current size */
+    bool suspended;
+} pending_configure;
+static _Atomic uint64_t configure_seq = 0;
+static _Atomic uint32_t shared_configure_serial = 0;
+static _Atomic uint64_t configures_received = 0;
+static uint64_t applied_configure_seq = 0;
+static bool configure_ack_pending = false;
+static uint32_t configure_ack_serial = 0;
+static uint64_t configures_acked = 0;
+static uint64_t configures_coalesced = 0;   /* serials replaced before a frame used them */
+static uint64_t resizes = 0;
+
+/*
+ * Presentation mode: VSYNC paces frames (frame callbacks or timed queue);
+ * ASYNC asks for tearing page flips and renders uncapped without frame
+ * callbacks. SIGUSR1 toggles between the two at runtime.
+ */
+enum present_mode {
+    PRESENT_VSYNC,
+    PRESENT_ASYNC,
+};
+static enum present_mode present_mode = PRESENT_VSYNC;
+static volatile sig_atomic_t present_mode_toggle = 0;
+
+/* Screenshot: the next frame is read back and written out through the event loop */
+static volatile sig_atomic_t screenshot_requested = 0;
+static int screenshot_count = 0;
+
+/* Frame pacing: one frame is rendered per wl_surface.frame callback */
+static struct wl_callback *frame_callback = NULL;
+static bool frame_ready = true;
+
+/*
+ * Visibility: a frame callback is kept outstanding in every mode and acts as
+ * a probe. If it has not fired within FRAME_STALL_NS the surface is treated
+ * as occluded; together with XDG_TOPLEVEL_STATE_SUSPENDED this puts the loop
+ * into an idle state that blocks on the socket and renders nothing.
+ */
+#define FRAME_STALL_NS 500000000ull
+static uint64_t frame_callback_requested_ns = 0;
+static bool suspended = false;
+static bool idle = false;
+static uint64_t idle_since_ns = 0;
+
+/*
+ * Timed presentation: with fifo-v1 (plus commit-timing-v1 when available)
+ * frames are queued with target timestamps instead of waiting for frame
+ * callbacks; up to TIMED_QUEUE_DEPTH frames may await presentation.
+ */
+#define TIMED_QUEUE_DEPTH 2
+static bool timed_present = false;
+static bool force_frame_callbacks = false;
+static int frames_queued = 0;
+static uint64_t last_target_ns = 0;
+
+/* Presentation statistics: since startup and since the last periodic summary */
+static struct present_stats present_total;
+static struct present_stats present_interval;
+static struct present_stats present_by_mode[2]; /* indexed by enum present_mode */
+static double stats_interval = 5.0; /* seconds between summaries, 0 disables */
+
+/* Late latching: start each frame just before the predicted vblank */
+static struct frame_scheduler scheduler;
+static bool late_latch = true;
+
+/* Animation time follows frame timestamps, not the number of frames drawn */
+#define ANIM_FIXED_STEP (1.0 / 240.0)
+#define ANIM_MAX_STEP   0.1
+static struct anim_clock anim;
+static enum anim_step_policy anim_policy = ANIM_STEP_VARIABLE;
+
+/*
+ * Startup runs as a state machine inside client_dispatch() instead of
+ * blocking roundtrips: each phase ends with a wl_display_sync callback (or
+ * the first configure), and EGL setup that needs no compositor state runs
+ * while the registry is in flight.
+ */
+enum startup_phase {
+    STARTUP_REGISTRY,   /* globals being announced */
+    STARTUP_WINDOW,     /* window created; waiting for the globals' initial events and the first configure */
+    STARTUP_REOPEN,     /* --reopen: replacement window waiting for its first configure */
+    STARTUP_DONE,
+};
+static enum startup_phase startup_phase = STARTUP_REGISTRY;
+static struct wl_callback *startup_sync = NULL;
+static uint64_t window_configure_seq = 0;  /* configure_seq when the window was created */
+
+/* --reopen: a closed window is replaced, reusing the EGL device */
+static bool reopen_on_close = false;
+static uint64_t reopen_begin_ns = 0;
+static uint64_t windows_reopened = 0;
+
+/*
+ * EGL display, config and context are created on a worker thread started
+ * right after connecting; it signals the wakeup source when done and the
+ * EGL state is only touched by the main thread after joining it. Startup
+ * times are CLOCK_MONOTONIC, reported once the first frame is swapped; the
+ * per-phase breakdown goes to startup_profile.
+ */
+static bool egl_thread_enabled = true;
+static const char *egl_thread_name = "egl";
+static pthread_t egl_thread;
+static bool egl_thread_started = false;
+static atomic_bool egl_context_ready = false;
+static atomic_bool egl_init_failed = false;    /* reported by the next client_dispatch() */
+static struct startup_profile profile;
+static const char *startup_report_path = NULL;  /* JSON report, "-" for stdout */
+static bool exit_after_first_frame = false;
+static int first_configure_phase = -1, egl_wait_phase = -1;
+static uint64_t egl_init_begin_ns = 0, egl_init_end_ns = 0;
+static uint64_t window_ready_ns = 0;    /* globals and first configure received */
+static uint64_t first_pixel_ns = 0;     /* placeholder committed */
+static uint64_t first_frame_ns = 0;
+
+/*
+ * Placeholder first frame: committed on the first configure in the first
+ * background color so the window shows up before EGL is ready, stretched
+ * with wp_viewport when available. The first GL frame drops the viewport in
+ * its own commit and the placeholder buffer is destroyed after it.
+ */
+static struct wl_shm *shm = NULL;
+static struct wp_viewporter *viewporter = NULL;
+static struct wp_single_pixel_buffer_manager_v1 *single_pixel_manager = NULL;
+static struct wp_viewport *placeholder_viewport = NULL;
+static struct wl_buffer *placeholder_buffer = NULL;
+static const char *placeholder_kind = "none";
+
+/* Seats and their pointer cursors; lives on the dispatching side like the other handlers */
+static struct cursor cursor;
+
+/* Forward */
+static void destroy_egl();
+
+/* xdg_wm_base ping handler */
+static void xdg_wm_base_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial) {
+    xdg_wm_base_pong(wm_base, serial);
+}
+static const struct xdg_wm_base_listener xdg_wm_base_listener = {
+    .ping = xdg_wm_base_ping,
+};
+
+/* xdg_surface / toplevel configure */
+static void xdg_surface_configure(void *data, struct xdg_surface *surface, uint32_t serial) {
+    /* End of a configure sequence: hand its final state and serial to the render loop,
+       which acks once content at that state exists (see apply_configure) */
+    atomic_fetch_add(&configure_seq, 1);
+    if (pending_configure.width > 0 && pending_configure.height > 0)
+        atomic_store(&shared_size, (uint64_t)pending_configure.width << 32 | (uint32_t)pending_configure.height);
+    atomic_store(&shared_configure_serial, serial);
+    atomic_fetch_add(&configure_seq, 1);
+
+    atomic_store(&shared_suspended, pending_configure.suspended);
+    atomic_fetch_add(&configures_received, 1);
+}
+static const struct xdg_surface_listener xdg_surface_listener = {
+    .configure = xdg_surface_configure,
+};
+
+static void xdg_toplevel_configure(void *data, struct xdg_toplevel *toplevel, int32_t w, int32_t h, struct wl_array *states) {
+    uint32_t *state;
+    bool is_suspended = false;
+    wl_array_for_each(state, states) {
+        if (*state == XDG_TOPLEVEL_STATE_SUSPENDED) is_suspended = true;
+    }
+    /* Only recorded; applied when xdg_surface.configure ends the sequence */
+    pending_configure.suspended = is_suspended;
+    pending_configure.width = w;
+    pending_configure.height = h;
+}
+static void xdg_toplevel_close(void *data, struct xdg_toplevel *toplevel) {
+    /* The compositor requested our window to close; the host decides what to do */
+    atomic_store(&closed, true);
+}
+static void xdg_toplevel_configure_bounds(void *data, struct xdg_toplevel *toplevel, int32_t w, int32_t h) {
+}
+static void xdg_toplevel_wm_capabilities(void *data, struct xdg_toplevel *toplevel, struct wl_array *capabilities) {
+}
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+    .configure = xdg_toplevel_configure,
+    .close = xdg_toplevel_close,
+    .configure_bounds = xdg_toplevel_configure_bounds,
+    .wm_capabilities = xdg_toplevel_wm_capabilities,
+};
+
+/* zxdg decoration listener: compositor tells us which mode it chose */
+static void decoration_configure(void *data, struct zxdg_toplevel_decoration_v1 *decoration, uint32_t mode) {
+    /* mode is one of ZXDG_TOPLEVEL_DECORATION_V1_MODE_SERVER_SIDE
+       or ZXDG_TOPLEVEL_DECORATION_V1_MODE_CLIENT_SIDE (and possibly others).
+       If compositor picks SERVER_SIDE, compositor will draw titlebar/borders.
+       If it picks CLIENT_SIDE, app must draw its own decorations (fallback).
+    */
+    if (mode == ZXDG_TOPLEVEL_DECORATION_V1_MODE_SERVER_SIDE) {
+        fprintf(stderr, "Decoration: compositor chose SERVER_SIDE (use SSD)\n");
+        /* If compositor chose server-side decoration, the compositor will
+           expect the client NOT to draw its own titlebar. Typically you'd
+           resize/redraw content accordingly and ack configure. */
+    } else if (mode == ZXDG_TOPLEVEL_DECORATION_V1_MODE_CLIENT_SIDE) {
+        fprintf(stderr, "Decoration: compositor chose CLIENT_SIDE (fallback to CSD)\n");
+    } else {
+        fprintf(stderr, "Decoration: unknown mode %u\n", mode);
+    }
+}
+static const struct zxdg_toplevel_decoration_v1_listener decoration_listener = {
+    .configure = decoration_configure,
+};
+
+/* wl_surface.frame: compositor signals it is a good time to draw the next frame */
+static void frame_done(void *data, struct wl_callback *callback, uint32_t time) {
+    wl_callback_destroy(callback);
+    frame_callback = NULL;
+    frame_ready = true;
+}
+static const struct wl_callback_listener frame_listener = {
+    .done = frame_done,
+};
+
+static uint64_t clock_now_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* wp_presentation: learn which clock domain feedback timestamps use */
+static void presentation_clock_id(void *data, struct wp_presentation *wp_presentation, uint32_t clk_id) {
+    presentation_clock = (clockid_t)clk_id;
+}
+static const struct wp_presentation_listener presentation_listener = {
+    .clock_id = presentation_clock_id,
+};
+
+/* Feedback for one committed frame */
+struct frame_feedback {
+    struct wp_presentation_feedback *feedback;
+    uint64_t commit_ns;
+    uint64_t target_ns; /* deadline the scheduler aimed this frame at, 0 if none */
+    enum present_mode mode;
+    bool queued;        /* counted in frames_queued */
+};
+
+static void frame_feedback_finish(struct frame_feedback *fb, const struct present_sample *sample) {
+    if (fb->queued) frames_queued--;
+    present_stats_add(&present_total, sample);
+    present_stats_add(&present_interval, sample);
+    present_stats_add(&present_by_mode[fb->mode], sample);
+    wp_presentation_feedback_destroy(fb->feedback);
+    free(fb);
+}
+
+static void feedback_sync_output(void *data, struct wp_presentation_feedback *feedback, struct wl_output *output) {
+}
+static void feedback_presented(void *data, struct wp_presentation_feedback *feedback,
+                               uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec,
+                               uint32_t refresh, uint32_t seq_hi, uint32_t seq_lo, uint32_t flags) {
+    struct frame_feedback *fb = data;
+    struct present_sample sample = {
+        .commit_ns = fb->commit_ns,
+        .present_ns = ((((uint64_t)tv_sec_hi << 32) | tv_sec_lo) * 1000000000ull) + tv_nsec,
+        .refresh_ns = refresh,
+        .seq = ((uint64_t)seq_hi << 32) | seq_lo,
+        .flags = flags,
+        .presented = true,
+    };
+    frame_scheduler_presented(&scheduler, fb->target_ns, sample.present_ns, refresh);
+    frame_feedback_finish(fb, &sample);
+}
+static void feedback_discarded(void *data, struct wp_presentation_feedback *feedback) {
+    struct frame_feedback *fb = data;
+    struct present_sample sample = {
+        .commit_ns = fb->commit_ns,
+        .presented = false,
+    };
+    frame_feedback_finish(fb, &sample);
+}
+static const struct wp_presentation_feedback_listener feedback_listener = {
+    .sync_output = feedback_sync_output,
+    .presented = feedback_presented,
+    .discarded = feedback_discarded,
+};
+
+/* Retarget the frame scheduler at the refresh of the output the surface is on */
+static void update_current_output(struct output *output) {
+    if (!output) {
+        struct output *o;
+        wl_list_for_each(o, &outputs, link) {
+            if (o->entered) output = o;
+        }
+    }
+    current_output = output;
+    cursor_set_scale(&cursor, output ? output->scale : 1);
+    if (!output || output->refresh_mhz <= 0) return;
+
+    uint64_t refresh_ns = 1000000000000ull / (uint64_t)output->refresh_mhz;
+    if (refresh_ns != atomic_load(&shared_refresh_ns)) {
+        fprintf(stderr, "Output: %s %dx%d@%.2fHz scale %d\n",
+                output->name[0] ? output->name : "(unnamed)",
+                output->width, output->height, output->refresh_mhz / 1000.0, output->scale);
+    }
+    /* The scheduler belongs to the render loop, see apply_protocol_state() */
+    atomic_store(&shared_refresh_ns, refresh_ns);
+}
+
+static void output_geometry(void *data, struct wl_output *wl_output, int32_t x, int32_t y,
+                            int32_t physical_width, int32_t physical_height, int32_t subpixel,
+                            const char *make, const char *model, int32_t transform) {
+}
+static void output_mode(void *data, struct wl_output *wl_output, uint32_t flags,
+                        int32_t w, int32_t h, int32_t refresh) {
+    struct output *output = data;
+    if (!(flags & WL_OUTPUT_MODE_CURRENT)) return;
+    output->width = w;
+    output->height = h;
+    output->refresh_mhz = refresh;
+}
+static void output_done(void *data, struct wl_output *wl_output) {
+    struct output *output = data;
+    /* A mode change on the output we are on takes effect now */
+    if (output == current_output) update_current_output(output);
+}
+static void output_scale(void *data, struct wl_output *wl_output, int32_t factor) {
+    struct output *output = data;
+    output->scale = factor;
+}
+static void output_name(void *data, struct wl_output *wl_output, const char *name) {
+    struct output *output = data;
+    snprintf(output->name, sizeof(output->name), "%s", name);
+}
+static void output_description(void *data, struct wl_output *wl_output, const char *description) {
+}
+static const struct wl_output_listener output_listener = {
+    .geometry = output_geometry,
+    .mode = output_mode,
+    .done = output_done,
+    .scale = output_scale,
+    .name = output_name,
+    .description = output_description,
+};
+
+static void output_destroy(struct output *output) {
+    if (wl_output_get_version(output->wl_output) >= WL_OUTPUT_RELEASE_SINCE_VERSION)
+        wl_output_release(output->wl_output);
+    else
+        wl_output_destroy(output->wl_output);
+    wl_list_remove(&output->link);
+    free(output);
+}
+
+/* wl_surface.enter/leave: track the outputs the window is on */
+static void surface_enter(void *data, struct wl_surface *surface, struct wl_output *wl_output) {
+    /* NULL once the output proxy is gone (global_remove on hot-unplug) */
+    if (!wl_output) return;
+    struct output *output = wl_output_get_user_data(wl_output);
+    output->entered = true;
+    update_current_output(output);
+}
+static void surface_leave(void *data, struct wl_surface *surface, struct wl_output *wl_output) {
+    if (!wl_output) return;
+    struct output *output = wl_output_get_user_data(wl_output);
+    output->entered = false;
+    if (output == current_output) update_current_output(NULL);
+}
+static const struct wl_surface_listener surface_listener = {
+    .enter = surface_enter,
+    .leave = surface_leave,
+};
+
+/* Registry handler: bind compositor, xdg_wm_base, decoration manager, presentation and outputs */
+static void registry_handle_global(void *data, struct wl_registry *registry, uint32_t id, const char *interface, uint32_t version) {
+    if (strcmp(interface, wl_compositor_interface.name) == 0) {
+        compositor = wl_registry_bind(registry, id, &wl_compositor_interface, 4);
+    } else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
+        /* v6 for the suspended toplevel state */
+        xdg_wm = wl_registry_bind(registry, id, &xdg_wm_base_interface, version < 6 ? version : 6);
+        xdg_wm_base_add_listener(xdg_wm, &xdg_wm_base_listener, NULL);
+    } else if (strcmp(interface, zxdg_decoration_manager_v1_interface.name) == 0) {
+        /* bind decoration manager (version 1) */
+        decoration_manager = wl_registry_bind(registry, id, &zxdg_decoration_manager_v1_interface, 1);
+    } else if (strcmp(interface, wp_presentation_interface.name) == 0) {
+        presentation = wl_registry_bind(registry, id, &wp_presentation_interface, 1);
+        wp_presentation_add_listener(presentation, &presentation_listener, NULL);
+#ifdef HAVE_FIFO_V1
+    } else if (strcmp(interface, wp_fifo_manager_v1_interface.name) == 0) {
+        fifo_manager = wl_registry_bind(registry, id, &wp_fifo_manager_v1_interface, 1);
+#endif
+#ifdef HAVE_COMMIT_TIMING_V1
+    } else if (strcmp(interface, wp_commit_timing_manager_v1_interface.name) == 0) {
+        commit_timing_manager = wl_registry_bind(registry, id, &wp_commit_timing_manager_v1_interface, 1);
+#endif
+    } else if (strcmp(interface, wp_tearing_control_manager_v1_interface.name) == 0) {
+        tearing_manager = wl_registry_bind(registry, id, &wp_tearing_control_manager_v1_interface, 1);
+    } else if (strcmp(interface, wl_shm_interface.name) == 0) {
+        shm = wl_registry_bind(registry, id, &wl_shm_interface, 1);
+    } else if (strcmp(interface, wp_viewporter_interface.name) == 0) {
+        viewporter = wl_registry_bind(registry, id, &wp_viewporter_interface, 1);
+    } else if (strcmp(interface, wp_single_pixel_buffer_manager_v1_interface.name) == 0) {
+        single_pixel_manager = wl_registry_bind(registry, id, &wp_single_pixel_buffer_manager_v1_interface, 1);
+    } else if (strcmp(interface, wp_cursor_shape_manager_v1_interface.name) == 0) {
+        cursor.shape_manager = wl_registry_bind(registry, id, &wp_cursor_shape_manager_v1_interface, 1);
+    } else if (strcmp(interface, wl_seat_interface.name) == 0) {
+        /* v5 for wl_seat.release and pointer frames */
+        cursor_add_seat(&cursor, wl_registry_bind(registry, id, &wl_seat_interface, version < 5 ? version : 5), id);
+    } else if (strcmp(interface, wl_output_interface.name) == 0) {
+        struct output *output = calloc(1, sizeof(*output));
+        output->global_name = id;
+        output->scale = 1;
+        /* v4 for the output name */
+        output->wl_output = wl_registry_bind(registry, id, &wl_output_interface, version < 4 ? version : 4);
+        wl_output_add_listener(output->wl_output, &output_listener, output);
+        wl_list_insert(&outputs, &output->link);
+    }
+}
+static void registry_handle_global_remove(void *data, struct wl_registry *registry, uint32_t name) {
+    if (cursor_remove_seat(&cursor, name)) return;
+
+    struct output *output, *tmp;
+    wl_list_for_each_safe(output, tmp, &outputs, link) {
+        if (output->global_name != name) continue;
+        bool was_current = output == current_output;
+        output_destroy(output);
+        if (was_current) update_current_output(NULL);
+    }
+}
+static const struct wl_registry_listener registry_listener = {
+    .global = registry_handle_global,
+    .global_remove = registry_handle_global_remove,
+};
+
+/* Create Wayland surface + xdg objects */
+static void create_window() {
+    wl_surface = wl_compositor_create_surface(compositor);
+    wl_surface_add_listener(wl_surface, &surface_listener, NULL);
+    xdg_surface = xdg_wm_base_get_xdg_surface(xdg_wm, wl_surface);
+    xdg_surface_add_listener(xdg_surface, &xdg_surface_listener, NULL);
+
+    xdg_toplevel = xdg_surface_get_toplevel(xdg_surface);
+    xdg_toplevel_add_listener(xdg_toplevel, &xdg_toplevel_listener, NULL);
+    xdg_toplevel_set_title(xdg_toplevel, "wayland-egl-demo (with xdg-decoration request)");
+    if (fullscreen) xdg_toplevel_set_fullscreen(xdg_toplevel, NULL);
+
+    /* If decoration manager was advertised, create decoration object and request SSD */
+    if (decoration_manager) {
+        toplevel_decoration = zxdg_decoration_manager_v1_get_toplevel_decoration(decoration_manager, xdg_toplevel);
+        zxdg_toplevel_decoration_v1_add_listener(toplevel_decoration, &decoration_listener, NULL);
+
+        /* Request server-side decorations (compositor may accept or ignore). */
+        zxdg_toplevel_decoration_v1_set_mode(toplevel_decoration, ZXDG_TOPLEVEL_DECORATION_V1_MODE_SERVER_SIDE);
+        /* Note: after requesting a mode, compositor will emit xdg_surface.configure. */
+    }
+
+#ifdef HAVE_FIFO_V1
+    if (timed_present) {
+        fifo = wp_fifo_manager_v1_get_fifo(fifo_manager, wl_surface);
+#ifdef HAVE_COMMIT_TIMING_V1
+        if (commit_timing_manager) commit_timer = wp_commit_timing_manager_v1_get_timer(commit_timing_manager, wl_surface);
+#endif
+    }
+#endif
+
+    if (tearing_manager) {
+        tearing_control = wp_tearing_control_manager_v1_get_tearing_control(tearing_manager, wl_surface);
+        if (present_mode == PRESENT_ASYNC)
+            wp_tearing_control_v1_set_presentation_hint(tearing_control, WP_TEARING_CONTROL_V1_PRESENTATION_HINT_ASYNC);
+    }
+
+    wl_surface_commit(wl_surface);
+}
+
+/* Everything create_window() made, in reverse */
+static void destroy_window() {
+    if (frame_callback) {
+        wl_callback_destroy(frame_callback);
+        frame_callback = NULL;
+    }
+    if (placeholder_viewport) {
+        wp_viewport_destroy(placeholder_viewport);
+        placeholder_viewport = NULL;
+    }
+    if (toplevel_decoration) {
+        zxdg_toplevel_decoration_v1_destroy(toplevel_decoration);
+        toplevel_decoration = NULL;
+    }
+#ifdef HAVE_COMMIT_TIMING_V1
+    if (commit_timer) {
+        wp_commit_timer_v1_destroy(commit_timer);
+        commit_timer = NULL;
+    }
+#endif
+#ifdef HAVE_FIFO_V1
+    if (fifo) {
+        wp_fifo_v1_destroy(fifo);
+        fifo = NULL;
+    }
+#endif
+    if (tearing_control) {
+        wp_tearing_control_v1_destroy(tearing_control);
+        tearing_control = NULL;
+    }
+    if (xdg_toplevel) {
+        xdg_toplevel_destroy(xdg_toplevel);
+        xdg_toplevel = NULL;
+    }
+    if (xdg_surface) {
+        xdg_surface_destroy(xdg_surface);
+        xdg_surface = NULL;
+    }
+    if (render_surface && render_surface != wl_surface) wl_proxy_wrapper_destroy(render_surface);
+    render_surface = NULL;
+    if (wl_surface) {
+        wl_surface_destroy(wl_surface);
+        wl_surface = NULL;
+    }
+}
+
+/* Display, config and context: needs the wl_display only; false on failure */
+static bool create_egl_context() {
+    /* 2D content only: no depth, stencil or multisampling */
+    const struct egl_config_request request = {
+        .surface_type = EGL_WINDOW_BIT,
+        .renderable_type = EGL_OPENGL_ES2_BIT,
+        .red = 8, .green = 8, .blue = 8, .alpha = 8,
+    };
+    char desc[128];
+
+    /* Looked up here so it is timed apart from eglInitialize; the device takes it over */
+    int phase = startup_profile_begin(&profile, "egl_get_display", egl_thread_name);
+    EGLDisplay platform_display = egl_get_wayland_display(display);
+    if (platform_display == EGL_NO_DISPLAY) {
+        fprintf(stderr, "Failed to get EGL display\n");
+        return false;
+    }
+    startup_profile_end(&profile, phase);
+
+    phase = startup_profile_begin(&profile, "egl_initialize", egl_thread_name);
+    egl_device = egl_device_acquire(display, platform_display);
+    if (!egl_device) {
+        fprintf(stderr, "Failed to initialize EGL\n");
+        return false;
+    }
+    egl_display = egl_device->display;
+    startup_profile_end(&profile, phase);
+
+    phase = startup_profile_begin(&profile, "egl_choose_config", egl_thread_name);
+    egl_config = egl_device_config(egl_device, &request);
+    if (!egl_config) {
+        fprintf(stderr, "No EGL configs\n");
+        return false;
+    }
+    startup_profile_end(&profile, phase);
+    egl_config_describe(egl_display, egl_config, desc, sizeof(desc));
+    fprintf(stderr, "EGL %d.%d, config %s\n", egl_device->major, egl_device->minor, desc);
+
+    phase = startup_profile_begin(&profile, "egl_create_context", egl_thread_name);
+    egl_context = egl_device_context(egl_device, egl_config);
+    if (egl_context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "Failed to create EGL context\n");
+        return false;
+    }
+    startup_profile_end(&profile, phase);
+    if (egl_device->no_config_context) fprintf(stderr, "EGL context: config-less (EGL_KHR_no_config_context)\n");
+
+    if (!frame_fences_init(&fences, egl_display, max_frames_in_flight))
+        fprintf(stderr, "EGL_KHR_fence_sync not available, frames in flight not limited\n");
+
+    const char *extensions = egl_device->extensions;
+    buffer_age_supported = egl_has_extension(extensions, "EGL_EXT_buffer_age");
+    if (egl_has_extension(extensions, "EGL_KHR_swap_buffers_with_damage"))
+        swap_buffers_with_damage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)eglGetProcAddress("eglSwapBuffersWithDamageKHR");
+    else if (egl_has_extension(extensions, "EGL_EXT_swap_buffers_with_damage"))
+        swap_buffers_with_damage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)eglGetProcAddress("eglSwapBuffersWithDamageEXT");
+    return true;
+}
+
+/* Needs a current context; warm starts load binaries instead of compiling. False on failure */
+static bool create_programs(const char *thread) {
+    static const char *const heartbeat_attribs[] = { "position", NULL };
+    uint64_t start = clock_now_ns(CLOCK_MONOTONIC);
+    int phase = startup_profile_begin(&profile, "shaders", thread);
+
+    program_cache_init(&program_cache);
+    heartbeat_program = program_cache_build(&program_cache, heartbeat_vertex_src, heartbeat_fragment_src,
+                                            heartbeat_attribs);
+    if (!heartbeat_program) {
+        fprintf(stderr, "Failed to build the heartbeat program\n");
+        return false;
+    }
+    heartbeat_level = glGetUniformLocation(heartbeat_program, "level");
+    startup_profile_end(&profile, phase);
+
+    fprintf(stderr, "Shaders: %.1f ms, %u from cache, %u compiled%s\n",
+            (clock_now_ns(CLOCK_MONOTONIC) - start) / 1e6, program_cache.hits, program_cache.misses,
+            program_cache.enabled ? "" : " (no GL_OES_get_program_binary, not cached)");
+    return true;
+}
+
+static void *egl_thread_main(void *data) {
+    egl_init_begin_ns = clock_now_ns(CLOCK_MONOTONIC);
+    bool ok = create_egl_context();
+    /* Shaders too if the context can be current without a surface; released for the main thread */
+    if (ok && egl_has_extension(egl_device->extensions, "EGL_KHR_surfaceless_context") &&
+        eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) {
+        ok = create_programs(egl_thread_name);
+        eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+    /* Never exit from here: the host learns of it from its next client_dispatch() */
+    if (!ok) {
+        atomic_store(&egl_init_failed, true);
+        event_source_wakeup_signal(wakeup);
+        return NULL;
+    }
+    egl_init_end_ns = clock_now_ns(CLOCK_MONOTONIC);
+    atomic_store(&egl_context_ready, true);
+    event_source_wakeup_signal(wakeup);
+    return NULL;
+}
+
+static void start_egl_init() {
+    if (egl_thread_enabled && pthread_create(&egl_thread, NULL, egl_thread_main, NULL) == 0) {
+        egl_thread_started = true;
+        return;
+    }
+    if (egl_thread_enabled) fprintf(stderr, "Failed to start the EGL init thread, initializing inline\n");
+    egl_thread_enabled = false;
+    egl_thread_name = "main";
+    egl_thread_main(NULL);
+}
+
+/*
+ * 1 once the context exists, 0 while the worker is still busy, -1 if EGL
+ * initialization failed; the worker's EGL state is visible after the join
+ */
+static int finish_egl_init() {
+    bool failed = atomic_load(&egl_init_failed);
+    if (!failed && !atomic_load(&egl_context_ready)) return 0;
+    if (egl_thread_started) {
+        pthread_join(egl_thread, NULL);
+        egl_thread_started = false;
+    }
+    return failed ? -1 : 1;
+}
+
+/* Window surface at the configured size; false on failure, destroy_egl_surface() cleans up */
+static bool create_egl_surface() {
+    egl_window = wl_egl_window_create(wl_surface, width, height);
+    if (!egl_window) {
+        fprintf(stderr, "Failed to create wl_egl_window\n");
+        return false;
+    }
+
+    egl_surface = eglCreateWindowSurface(egl_display, egl_config, (EGLNativeWindowType)egl_window, NULL);
+    if (egl_surface == EGL_NO_SURFACE) {
+        fprintf(stderr, "Failed to create EGL window surface\n");
+        return false;
+    }
+
+    if (!eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context)) {
+        fprintf(stderr, "Failed to make EGL context current\n");
+        return false;
+    }
+
+    /* Pacing is driven by frame callbacks, so eglSwapBuffers must never block on vsync */
+    eglSwapInterval(egl_display, 0);
+    if (!heartbeat_program && !create_programs("main")) return false;
+
+    glViewport(0, 0, width, height);
+    return true;
+}
+
+/* The window's share of EGL; the context and its programs stay with the device */
+static void destroy_egl_surface() {
+    if (egl_surface != EGL_NO_SURFACE) {
+        eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroySurface(egl_display, egl_surface);
+        egl_surface = EGL_NO_SURFACE;
+    }
+    if (egl_window) {
+        wl_egl_window_destroy(egl_window);
+        egl_window = NULL;
+    }
+}
+
+static void destroy_egl() {
+    destroy_egl_surface();
+    if (egl_device) {
+        frame_fences_finish(&fences);
+        egl_device_release(egl_device);
+        egl_device = NULL;
+    }
+    egl_display = EGL_NO_DISPLAY;
+    egl_context = EGL_NO_CONTEXT;
+    heartbeat_program = 0;  /* went away with the context */
+}
+
+/*
+ * Start of a frame: take the newest configure, resizing buffers at most once.
+ * Its serial is acked by the frame about to be rendered, which is forced by
+ * full damage even if the content would not change.
+ */
+static void apply_configure() {
+    uint64_t seq, size;
+    uint32_t serial;
+    do {
+        seq = atomic_load(&configure_seq);
+        size = atomic_load(&shared_size);
+        serial = atomic_load(&shared_configure_serial);
+    } while ((seq & 1) || seq != atomic_load(&configure_seq));
+
+    if (seq == applied_configure_seq) return;
+    uint64_t count = (seq - applied_configure_seq) / 2;
+    applied_configure_seq = seq;
+    if (configure_ack_pending) count++;   /* the serial not yet acked is dropped too */
+    configures_coalesced += count - 1;
+    configure_ack_pending = true;
+    configure_ack_serial = serial;
+
+    int w = (int)(size >> 32);
+    int h = (int)(uint32_t)size;
+    damage_add(&pending_damage, 0, 0, w, h);
+    if (w == width && h == height) return;
+    width = w;
+    height = h;
+    if (egl_window) {
+        wl_egl_window_resize(egl_window, width, height, 0, 0);
+        resizes++;
+    }
+}
+
+/* Ack the configure the next commit satisfies */
+static void ack_configure() {
+    if (!configure_ack_pending) return;
+    xdg_surface_ack_configure(xdg_surface, configure_ack_serial);
+    configure_ack_pending = false;
+    configures_acked++;
+}
+
+/*
+ * Content sources: each marks what changes in the frame at frame_ns and
+ * returns when it will change next (UINT64_MAX: not until an event).
+ */
+typedef uint64_t (*content_invalidate_fn)(uint64_t frame_ns, struct damage *damage);
+
+/* Full-window clear color, continuously animated unless --static */
+static uint64_t background_invalidate(uint64_t frame_ns, struct damage *damage) {
+    if (!animate) return UINT64_MAX;
+    damage_add(damage, 0, 0, width, height);
+    return frame_ns;
+}
+
+/* Small square in the top-left corner that blinks once per second */
+static uint64_t heartbeat_invalidate(uint64_t frame_ns, struct damage *damage) {
+    uint64_t second = frame_ns / 1000000000ull;
+    if (second != heartbeat_second) {
+        heartbeat_second = second;
+        damage_add(damage, HEARTBEAT_MARGIN, HEARTBEAT_MARGIN, HEARTBEAT_SIZE, HEARTBEAT_SIZE);
+    }
+    return (second + 1) * 1000000000ull;
+}
+
+static const content_invalidate_fn content_sources[] = {
+    background_invalidate,
+    heartbeat_invalidate,
+};
+
+/* Gather this frame's damage; returns when a source changes next */
+static uint64_t collect_damage(uint64_t frame_ns, struct damage *damage) {
+    uint64_t next_change_ns = UINT64_MAX;
+
+    *damage = pending_damage;
+    damage_clear(&pending_damage);
+    for (size_t i = 0; i < sizeof(content_sources) / sizeof(content_sources[0]); i++) {
+        uint64_t next = content_sources[i](frame_ns, damage);
+        if (next < next_change_ns) next_change_ns = next;
+    }
+    return next_change_ns;
+}
+
+/* Background color at animation time t */
+static void background_color(double t, float *r, float *g, float *b) {
+    if (!animate) t = 0.0;
+    *r = (sin(t) * 0.5f) + 0.5f;
+    *g = (sin(t + 2.0) * 0.5f) + 0.5f;
+    *b = (sin(t + 4.0) * 0.5f) + 0.5f;
+}
+
+static void draw_content(double t, const struct damage_rect *clip) {
+    float r, g, b;
+    background_color(t, &r, &g, &b);
+
+    glViewport(0, 0, width, height);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(clip->x, height - clip->y - clip->height, clip->width, clip->height);
+    glClearColor(r, g, b, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    struct damage_rect heartbeat = { HEARTBEAT_MARGIN, HEARTBEAT_MARGIN, HEARTBEAT_SIZE, HEARTBEAT_SIZE };
+    struct damage_rect area;
+    if (damage_rect_intersect(clip, &heartbeat, &area)) {
+        float x0 = 2.0f * heartbeat.x / width - 1.0f;
+        float x1 = 2.0f * (heartbeat.x + heartbeat.width) / width - 1.0f;
+        float y0 = 1.0f - 2.0f * heartbeat.y / height;
+        float y1 = 1.0f - 2.0f * (heartbeat.y + heartbeat.height) / height;
+        const GLfloat quad[] = { x0, y0, x1, y0, x0, y1, x1, y1 };
+
+        glScissor(area.x, height - area.y - area.height, area.width, area.height);
+        glUseProgram(heartbeat_program);
+        glUniform1f(heartbeat_level, heartbeat_second % 2 ? 1.0f : 0.2f);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, quad);
+        glEnableVertexAttribArray(0);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+    glDisable(GL_SCISSOR_TEST);
+}
+
+/* eglSwapBuffers, passing the damage (flipped to bottom-left origin) when supported */
+static void swap_with_damage(const struct damage *damage) {
+    if (!swap_buffers_with_damage) {
+        eglSwapBuffers(egl_display, egl_surface);
+        return;
+    }
+
+    EGLint rects[DAMAGE_MAX_RECTS * 4];
+    for (int i = 0; i < damage->count; i++) {
+        const struct damage_rect *r = &damage->rects[i];
+        rects[i * 4 + 0] = r->x;
+        rects[i * 4 + 1] = height - r->y - r->height;
+        rects[i * 4 + 2] = r->width;
+        rects[i * 4 + 3] = r->height;
+    }
+    swap_buffers_with_damage(egl_display, egl_surface, rects, damage->count);
+}
+
+struct screenshot {
+    int fd;
+    uint8_t *data;
+    char path[64];
+};
+
+static void screenshot_written(void *data, ssize_t result) {
+    struct screenshot *shot = data;
+    close(shot->fd);
+    if (result < 0)
+        fprintf(stderr, "Screenshot: writing %s failed: %s\n", shot->path, strerror((int)-result));
+    else
+        fprintf(stderr, "Screenshot: %s (%zd bytes)\n", shot->path, result);
+    free(shot->data);
+    free(shot);
+}
+
+/* Read back the frame just drawn; the file write does not block the frame with io_uring */
+static void save_screenshot() {
+    struct screenshot *shot = calloc(1, sizeof(*shot));
+    size_t size = 0;
+    snprintf(shot->path, sizeof(shot->path), "screenshot-%03d.ppm", ++screenshot_count);
+    shot->data = screenshot_read_ppm(width, height, &size);
+    shot->fd = open(shot->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (!shot->data || shot->fd < 0) {
+        fprintf(stderr, "Screenshot: cannot write %s\n", shot->path);
+        if (shot->fd >= 0) close(shot->fd);
+        free(shot->data);
+        free(shot);
+        return;
+    }
+    event_loop_write(loop, shot->fd, shot->data, size, 0, screenshot_written, shot);
+}
+
+/* Time to first frame, and how much of EGL init the compositor round trips hid */
+static void report_startup() {
+    uint64_t egl_ns = egl_init_end_ns - egl_init_begin_ns;
+    uint64_t waited_ns = egl_init_end_ns > window_ready_ns ? egl_init_end_ns - window_ready_ns : 0;
+    uint64_t hidden_ns = egl_ns > waited_ns ? egl_ns - waited_ns : 0;
+    if (!egl_thread_enabled) hidden_ns = 0;  /* inline init blocks the main thread throughout */
+    double first_pixel_ms = first_pixel_ns ? startup_profile_ms(&profile, first_pixel_ns) : 0.0;
+    double first_frame_ms = startup_profile_ms(&profile, first_frame_ns);
+    double window_ready_ms = startup_profile_ms(&profile, window_ready_ns);
+    fprintf(stderr, "Startup: first pixel %.1f ms (%s), first GL frame %.1f ms after connect, "
+            "window ready at %.1f ms, EGL init %.1f ms (%s, %.1f ms hidden behind the compositor)\n",
+            first_pixel_ms, placeholder_kind, first_frame_ms, window_ready_ms,
+            egl_ns / 1e6, egl_thread_enabled ? "worker thread" : "inline", hidden_ns / 1e6);
+
+    if (startup_report_path) {
+        static const char *const names[] = {
+            "first_pixel", "first_frame", "window_ready", "egl_init", "egl_hidden", NULL,
+        };
+        const double values[] = { first_pixel_ms, first_frame_ms, window_ready_ms, egl_ns / 1e6, hidden_ns / 1e6 };
+        bool to_stdout = strcmp(startup_report_path, "-") == 0;
+        FILE *out = to_stdout ? stdout : fopen(startup_report_path, "w");
+        if (out) {
+            startup_profile_write_json(&profile, out, names, values);
+            if (to_stdout) fflush(out);
+            else fclose(out);
+        } else {
+            fprintf(stderr, "Cannot write startup report %s\n", startup_report_path);
+        }
+    }
+    if (exit_after_first_frame) atomic_store(&closed, true);
+}
+
+/* Draw one frame and commit it together with the next frame callback request */
+static void render_frame(double t, const struct damage *damage) {
+    int first_frame_phase = first_frame_ns ? -1 : startup_profile_begin(&profile, "first_frame", "main");
+    frame_scheduler_begin_frame(&scheduler);
+
+    /* Repaint what changed now plus what changed since this back buffer was last shown */
+    struct damage repaint = *damage;
+    EGLint age = 0;
+    if (buffer_age_supported) eglQuerySurface(egl_display, egl_surface, EGL_BUFFER_AGE_EXT, &age);
+    if (age > 0 && age <= DAMAGE_HISTORY) {
+        for (int i = 0; i < age - 1; i++) damage_union(&repaint, &damage_history[i]);
+    } else {
+        damage_add(&repaint, 0, 0, width, height);
+    }
+    memmove(&damage_history[1], &damage_history[0], sizeof(damage_history[0]) * (DAMAGE_HISTORY - 1));
+    damage_history[0] = *damage;
+
+    struct damage_rect clip = damage_extents(&repaint);
+    draw_content(t, &clip);
+    if (screenshot_requested) {
+        screenshot_requested = 0;
+        save_screenshot();
+    }
+    frame_fences_insert(&fences);
+
+    frames_drawn++;
+    repaint_fraction_sum += (double)clip.width * clip.height / ((double)width * height);
+
+    /* Surface state must be set before eglSwapBuffers, which performs the wl_surface.commit */
+    if (present_mode == PRESENT_ASYNC) {
+        /* Uncapped: no frame callback, no barrier, the compositor flips as soon as it can */
+    } else if (timed_present) {
+        /* Present no earlier than the previous frame's refresh, and at the target if known */
+#ifdef HAVE_FIFO_V1
+        wp_fifo_v1_set_barrier(fifo);
+        wp_fifo_v1_wait_barrier(fifo);
+#endif
+#ifdef HAVE_COMMIT_TIMING_V1
+        if (commit_timer && scheduler.target_ns) {
+            /* Aim half a refresh early so vblank jitter cannot push us one cycle late */
+            uint64_t when = scheduler.target_ns - scheduler.refresh_ns / 2;
+            uint64_t sec = when / 1000000000ull;
+            wp_commit_timer_v1_set_timestamp(commit_timer, (uint32_t)(sec >> 32), (uint32_t)sec,
+                                             (uint32_t)(when % 1000000000ull));
+        }
+#endif
+        last_target_ns = scheduler.target_ns;
+    }
+
+    /* Frame callback: paces frame-callback mode, and is the visibility probe otherwise */
+    if (!frame_callback) {
+        frame_callback = wl_surface_frame(render_surface);
+        wl_callback_add_listener(frame_callback, &frame_listener, NULL);
+        frame_callback_requested_ns = clock_now_ns(CLOCK_MONOTONIC);
+    }
+    if (present_mode == PRESENT_VSYNC && !timed_present) frame_ready = false;
+
+    /* Same for presentation feedback: it applies to the commit inside eglSwapBuffers */
+    struct frame_feedback *fb = NULL;
+    if (presentation) {
+        fb = calloc(1, sizeof(*fb));
+        fb->mode = present_mode;
+        fb->queued = present_mode == PRESENT_VSYNC && timed_present;
+        fb->target_ns = present_mode == PRESENT_VSYNC ? scheduler.target_ns : 0;
+        fb->feedback = wp_presentation_feedback(render_presentation, wl_surface);
+        wp_presentation_feedback_add_listener(fb->feedback, &feedback_listener, fb);
+        if (fb->queued) frames_queued++;
+    }
+
+    /* Ack and the buffer at the configured size land in the same commit */
+    ack_configure();
+    /* The GL buffer is shown unscaled: the viewport goes away with this commit */
+    if (placeholder_viewport) {
+        wp_viewport_destroy(placeholder_viewport);
+        placeholder_viewport = NULL;
+    }
+    swap_with_damage(damage);
+    if (placeholder_buffer) {
+        wl_buffer_destroy(placeholder_buffer);
+        placeholder_buffer = NULL;
+    }
+
+    if (fb) fb->commit_ns = clock_now_ns(presentation_clock);
+    frame_scheduler_end_frame(&scheduler);
+    if (!first_frame_ns) {
+        first_frame_ns = clock_now_ns(CLOCK_MONOTONIC);
+        startup_profile_end(&profile, first_frame_phase);
+        report_startup();
+    }
+}
+
+/* Print and restart the per-interval presentation summary when it is due */
+static void report_present_stats(uint64_t *next_report_ns) {
+    if (!presentation || stats_interval <= 0.0) return;
+
+    uint64_t now = clock_now_ns(CLOCK_MONOTONIC);
+    if (now < *next_report_ns) return;
+
+    present_stats_print(&present_interval, "present (interval)", stderr);
+    present_stats_print(&present_total, "present (total)", stderr);
+    /* Once both modes have been used, the latency gained by async is directly visible */
+    if (present_by_mode[PRESENT_VSYNC].presented && present_by_mode[PRESENT_ASYNC].presented) {
+        present_stats_print(&present_by_mode[PRESENT_VSYNC], "present (vsync)", stderr);
+        present_stats_print(&present_by_mode[PRESENT_ASYNC], "present (async)", stderr);
+        fprintf(stderr, "async latency gain: %.2f ms\n",
+                present_stats_latency_avg_ms(&present_by_mode[PRESENT_VSYNC]) -
+                present_stats_latency_avg_ms(&present_by_mode[PRESENT_ASYNC]));
+    }
+    /* With a dispatch thread the output list is not ours to read */
+    if (!dispatch_thread_enabled && current_output) {
+        fprintf(stderr, "output: %s %dx%d@%.2fHz scale %d\n",
+                current_output->name[0] ? current_output->name : "(unnamed)",
+                current_output->width, current_output->height,
+                current_output->refresh_mhz / 1000.0, current_output->scale);
+    }
+    if (fences.display != EGL_NO_DISPLAY) {
+        fprintf(stderr, "gpu queue: %d frames in flight max, waited %llu of %llu frames, %.2f ms total, %.2f ms max\n",
+                fences.limit, (unsigned long long)fences.waits, (unsigned long long)fences.frames,
+                fences.wait_ns / 1e6, fences.max_wait_ns / 1e6);
+    }
+    struct event_loop_flush_stats flush_stats;
+    event_loop_get_flush_stats(loop, &flush_stats);
+    fprintf(stderr, "socket: %llu flushes, %llu hit EAGAIN, %llu resumed on POLLOUT\n",
+            (unsigned long long)flush_stats.flushes, (unsigned long long)flush_stats.backpressure,
+            (unsigned long long)flush_stats.pollout_wakeups);
+    fprintf(stderr, "configure: %llu received, %llu acked, %llu coalesced, %llu buffer resizes\n",
+            (unsigned long long)atomic_load(&configures_received), (unsigned long long)configures_acked,
+            (unsigned long long)configures_coalesced, (unsigned long long)resizes);
+    fprintf(stderr, "redraw: %llu frames drawn, %llu wake-ups with nothing to draw, avg repaint %.1f%% of window\n",
+            (unsigned long long)frames_drawn, (unsigned long long)idle_wakeups,
+            frames_drawn ? 100.0 * repaint_fraction_sum / frames_drawn : 0.0);
+    if (late_latch) {
+        fprintf(stderr, "scheduler: render cost %.2f ms, margin %.2f ms, deadlines met %llu, missed %llu\n",
+                scheduler.render_cost_ns / 1e6, scheduler.margin_ns / 1e6,
+                (unsigned long long)scheduler.hits, (unsigned long long)scheduler.misses);
+    }
+    present_stats_clear_counters(&present_interval);
+    *next_report_ns = now + (uint64_t)(stats_interval * 1e9);
+}
+
+static void set_present_mode(enum present_mode mode) {
+    present_mode = mode;
+    /* The hint is double-buffered: it takes effect with the next frame's commit */
+    if (tearing_control) {
+        wp_tearing_control_v1_set_presentation_hint(tearing_control, mode == PRESENT_ASYNC
+                                                    ? WP_TEARING_CONTROL_V1_PRESENTATION_HINT_ASYNC
+                                                    : WP_TEARING_CONTROL_V1_PRESENTATION_HINT_VSYNC);
+    }
+    /* Back to paced mode: restart pacing from a fresh frame */
+    if (!frame_callback) frame_ready = true;
+    last_target_ns = 0;
+    fprintf(stderr, "Present mode: %s%s\n", mode == PRESENT_ASYNC ? "async" : "vsync",
+            tearing_control ? "" : " (wp_tearing_control_v1 not available)");
+}
+
+/* Suspended by the compositor, or frame callbacks have stopped arriving */
+static bool should_idle() {
+    if (suspended) return true;
+    return frame_callback && clock_now_ns(CLOCK_MONOTONIC) - frame_callback_requested_ns > FRAME_STALL_NS;
+}
+
+/*
+ * Zero-work idle state: while it lasts nothing is rendered and no timer is
+ * armed, so only a protocol event (configure, frame callback) wakes us.
+ * Returns whether the loop is idle.
+ */
+static bool update_idle() {
+    bool now_idle = should_idle();
+    if (now_idle && !idle) {
+        idle_since_ns = clock_now_ns(CLOCK_MONOTONIC);
+        event_source_timer_update(frame_timer, 0);
+        fprintf(stderr, "Idle: %s\n", suspended ? "suspended" : "frame callbacks stalled (occluded)");
+    } else if (!now_idle && idle) {
+        /* Whatever was queued before going idle has been retired or dropped */
+        last_target_ns = 0;
+        fprintf(stderr, "Resumed after %.1f ms idle\n", (clock_now_ns(CLOCK_MONOTONIC) - idle_since_ns) / 1e6);
+    }
+    idle = now_idle;
+    return idle;
+}
+
+/* Pick up what the protocol handlers published since the last iteration */
+static void apply_protocol_state() {
+    suspended = atomic_load(&shared_suspended);
+    uint64_t refresh_ns = atomic_load(&shared_refresh_ns);
+    if (refresh_ns != applied_refresh_ns) {
+        applied_refresh_ns = refresh_ns;
+        frame_scheduler_set_refresh(&scheduler, refresh_ns);
+    }
+}
+
+static void dispatch_stop_fn(void *data, uint32_t events) {
+    atomic_store(&dispatch_running, false);
+}
+
+static void *dispatch_thread_main(void *data) {
+    while (atomic_load(&dispatch_running)) {
+        if (event_loop_dispatch(dispatch_loop, -1) < 0) {
+            /* The host decides what happens next: fail its next client_dispatch() */
+            atomic_store(&dispatch_failed, true);
+            event_source_wakeup_signal(wakeup);
+            break;
+        }
+        /* Events may have been queued for the render thread */
+        event_source_wakeup_signal(wakeup);
+    }
+    return NULL;
+}
+
+/* From here on the main thread no longer reads the socket; false on failure */
+static bool start_dispatch_thread() {
+    dispatch_loop = event_loop_create(display, NULL);
+    dispatch_stop = dispatch_loop ? event_loop_add_wakeup(dispatch_loop, dispatch_stop_fn, NULL) : NULL;
+    if (dispatch_stop) {
+        atomic_store(&dispatch_running, true);
+        if (pthread_create(&dispatch_thread, NULL, dispatch_thread_main, NULL) == 0) return true;
+        fprintf(stderr, "Failed to start the dispatch thread\n");
+        event_source_remove(dispatch_stop);
+    } else {
+        fprintf(stderr, "Failed to set up the dispatch thread loop\n");
+    }
+    dispatch_stop = NULL;
+    if (dispatch_loop) event_loop_destroy(dispatch_loop);
+    dispatch_loop = NULL;
+    return false;
+}
+
+static void stop_dispatch_thread() {
+    event_source_wakeup_signal(dispatch_stop);
+    pthread_join(dispatch_thread, NULL);
+    event_source_remove(dispatch_stop);
+    event_loop_destroy(dispatch_loop);
+    dispatch_loop = NULL;
+}
+
+/* Arm the frame timer for a time on the presentation clock */
+static void arm_frame_timer(uint64_t when_ns) {
+    if (presentation_clock != CLOCK_MONOTONIC) {
+        /* timerfd cannot run on every presentation clock (e.g. CLOCK_MONOTONIC_RAW) */
+        uint64_t now = clock_now_ns(presentation_clock);
+        uint64_t delta = when_ns > now ? when_ns - now : 0;
+        when_ns = clock_now_ns(CLOCK_MONOTONIC) + delta;
+    }
+    event_source_timer_update(frame_timer, when_ns ? when_ns : 1);
+}
+
+/*
+ * One pass of the frame state machine: render a frame if it is time to.
+ * Returns false when it has to wait for an event (display, frame timer or
+ * wake-up), true when it can continue right away.
+ */
+static bool client_step(struct client *client) {
+    apply_protocol_state();
+
+    if (present_mode_toggle) {
+        present_mode_toggle = 0;
+        set_present_mode(present_mode == PRESENT_ASYNC ? PRESENT_VSYNC : PRESENT_ASYNC);
+        client->latch_planned = false;
+    }
+    /* The whole back buffer must be current for the readback */
+    if (screenshot_requested) damage_add(&pending_damage, 0, 0, width, height);
+
+    if (update_idle()) {
+        /* No frame is coming: ack a new configure with the current buffer */
+        apply_configure();
+        if (configure_ack_pending) {
+            ack_configure();
+            wl_surface_commit(wl_surface);
+        }
+        return false;
+    }
+
+    if (present_mode == PRESENT_VSYNC) {
+        /* Wait until the compositor asks for the next frame or retires a queued one */
+        if (timed_present ? frames_queued >= TIMED_QUEUE_DEPTH : !frame_ready) return false;
+
+        if (timed_present) {
+            /* The compositor holds the commit until its target, so never sleep here */
+            frame_scheduler_queue(&scheduler, last_target_ns, clock_now_ns(presentation_clock));
+        } else if (late_latch) {
+            /* Sleep on the frame timer until just before the predicted vblank */
+            uint64_t now = clock_now_ns(presentation_clock);
+            if (!client->latch_planned) {
+                client->latch_wakeup_ns = frame_scheduler_plan(&scheduler, now);
+                client->latch_planned = true;
+            }
+            if (client->latch_wakeup_ns > now) {
+                arm_frame_timer(client->latch_wakeup_ns);
+                return false;
+            }
+        }
+    }
+    client->latch_planned = false;
+
+    /* Keep the GPU no more than max_frames_in_flight frames behind */
+    frame_fences_throttle(&fences);
+    apply_configure();
+
+    /* simple animation, timed by when the frame is expected on screen if known */
+    uint64_t frame_ns = present_mode == PRESENT_VSYNC && scheduler.target_ns
+                        ? scheduler.target_ns : clock_now_ns(presentation_clock);
+    double t = anim_clock_advance(&anim, frame_ns);
+
+    report_present_stats(&client->next_report_ns);
+
+    struct damage damage;
+    uint64_t next_change_ns = collect_damage(frame_ns, &damage);
+    if (damage_empty(&damage)) {
+        /* Nothing changed: commit nothing, request no frame callback, just wait */
+        idle_wakeups++;
+        if (next_change_ns != UINT64_MAX) arm_frame_timer(next_change_ns);
+        return false;
+    }
+    render_frame(t, &damage);
+    return true;
+}
+
+static void startup_sync_done(void *data, struct wl_callback *callback, uint32_t time) {
+    startup_profile_end(&profile, (int)(intptr_t)data);
+    wl_callback_destroy(callback);
+    startup_sync = NULL;
+}
+static const struct wl_callback_listener startup_sync_listener = {
+    .done = startup_sync_done,
+};
+
+/* Mark the end of a startup phase: everything requested so far has been answered */
+static void startup_sync_request(const char *phase) {
+    int slot = startup_profile_begin(&profile, phase, "main");
+    startup_sync = wl_display_sync(display);
+    wl_callback_add_listener(startup_sync, &startup_sync_listener, (void *)(intptr_t)slot);
+}
+
+/* The registry has been announced: bind results are known, create the window */
+static int startup_globals() {
+    if (!compositor || !xdg_wm) {
+        fprintf(stderr, "Compositor or xdg_wm_base not available\n");
+        return -1;
+    }
+
+    /* Timed presentation needs fifo-v1 for queueing and presentation feedback for pacing */
+    timed_present = !force_frame_callbacks && fifo_manager && presentation;
+    fprintf(stderr, "Pacing: %s\n", timed_present
+            ? (commit_timing_manager ? "fifo-v1 + commit-timing-v1 target timestamps" : "fifo-v1 queue")
+            : "frame callbacks");
+    if (!presentation) fprintf(stderr, "wp_presentation not available, no presentation feedback\n");
+    cursor.compositor = compositor;
+    cursor.shm = shm;
+    fprintf(stderr, "Cursor: %s\n", cursor.shape_manager
+            ? "wp_cursor_shape_v1" : "wayland-cursor theme, loaded on first pointer enter");
+
+    int phase = startup_profile_begin(&profile, "create_window", "main");
+    create_window();
+    startup_profile_end(&profile, phase);
+    first_configure_phase = startup_profile_begin(&profile, "first_configure", "main");
+
+    /* Requests whose events the render thread consumes go through wrappers on its queue */
+    render_surface = wl_surface;
+    render_presentation = presentation;
+    if (render_queue) {
+        render_surface = wl_proxy_create_wrapper(wl_surface);
+        wl_proxy_set_queue((struct wl_proxy *)render_surface, render_queue);
+        if (presentation) {
+            render_presentation = wl_proxy_create_wrapper(presentation);
+            wl_proxy_set_queue((struct wl_proxy *)render_presentation, render_queue);
+        }
+    }
+
+    /* Answered after the bound globals' initial events (presentation clock, output modes) */
+    startup_sync_request("initial_events");
+    return 0;
+}
+
+/* Globals initialized and the first configure received: create the surface and start rendering; -1 on failure */
+static int startup_window(struct client *client) {
+    /* Scheduler times must share the feedback clock; it stays inactive without feedback */
+    frame_scheduler_init(&scheduler, presentation_clock);
+    applied_refresh_ns = 0;
+
+    /* create the EGL surface at the configured width/height */
+    apply_protocol_state();
+    apply_configure();
+    int phase = startup_profile_begin(&profile, "egl_surface", "main");
+    if (!create_egl_surface()) return -1;
+    startup_profile_end(&profile, phase);
+
+    anim_clock_init(&anim, anim_policy, ANIM_FIXED_STEP, ANIM_MAX_STEP);
+    damage_add(&pending_damage, 0, 0, width, height);
+    client->next_report_ns = clock_now_ns(CLOCK_MONOTONIC) + (uint64_t)(stats_interval * 1e9);
+
+    if (dispatch_thread_enabled) {
+        /* From here on the dispatch thread reads the socket and this loop consumes render_queue */
+        event_loop_set_queue(loop, render_queue);
+        if (!start_dispatch_thread()) return -1;
+    }
+    return 0;
+}
+
+/* Show the first background color right away, acking the first configure */
+static void commit_placeholder() {
+    float r, g, b;
+    bool single_pixel;
+    background_color(0.0, &r, &g, &b);
+
+    /* Stretched 1x1 when the compositor can scale, window-sized wl_shm otherwise */
+    int w = viewporter ? 1 : width;
+    int h = viewporter ? 1 : height;
+    placeholder_buffer = placeholder_buffer_create(single_pixel_manager, shm, w, h, r, g, b, &single_pixel);
+    if (!placeholder_buffer) return;
+    placeholder_kind = single_pixel ? "single-pixel buffer" : "wl_shm buffer";
+
+    if (viewporter) {
+        placeholder_viewport = wp_viewporter_get_viewport(viewporter, wl_surface);
+        wp_viewport_set_destination(placeholder_viewport, width, height);
+    }
+    ack_configure();
+    wl_surface_attach(wl_surface, placeholder_buffer, 0, 0);
+    wl_surface_damage_buffer(wl_surface, 0, 0, INT32_MAX, INT32_MAX);
+    wl_surface_commit(wl_surface);
+    first_pixel_ns = clock_now_ns(CLOCK_MONOTONIC);
+}
+
+/* Advance startup as far as the events received so far allow; -1 on failure */
+static int startup_step(struct client *client) {
+    /* Fails startup as soon as the worker gives up, not only once the window is configured */
+    if (atomic_load(&egl_init_failed) && finish_egl_init() < 0) return -1;
+    if (startup_phase == STARTUP_REGISTRY) {
+        if (startup_sync) return 0;
+        if (startup_globals() < 0) return -1;
+        startup_phase = STARTUP_WINDOW;
+    }
+    if (startup_phase == STARTUP_WINDOW) {
+        if (startup_sync || atomic_load(&configure_seq) == window_configure_seq) return 0;
+        if (!window_ready_ns) {
+            window_ready_ns = clock_now_ns(CLOCK_MONOTONIC);
+            startup_profile_end(&profile, first_configure_phase);
+            int phase = startup_profile_begin(&profile, "placeholder", "main");
+            apply_configure();
+            commit_placeholder();
+            startup_profile_end(&profile, phase);
+            egl_wait_phase = startup_profile_begin(&profile, "egl_wait", "main");
+        }
+        int egl_ready = finish_egl_init();
+        if (egl_ready <= 0) return egl_ready;
+        startup_profile_end(&profile, egl_wait_phase);
+        if (startup_window(client) < 0) return -1;
+        startup_phase = STARTUP_DONE;
+    }
+    if (startup_phase == STARTUP_REOPEN) {
+        if (atomic_load(&configure_seq) == window_configure_seq) return 0;
+        apply_protocol_state();
+        apply_configure();
+        uint64_t surface_begin_ns = clock_now_ns(CLOCK_MONOTONIC);
+        if (!create_egl_surface()) return -1;
+        uint64_t now = clock_now_ns(CLOCK_MONOTONIC);
+        damage_add(&pending_damage, 0, 0, width, height);
+        fprintf(stderr, "Window reopened (%llu): %.1f ms until configured, EGL surface %.2f ms (device reused)\n",
+                (unsigned long long)windows_reopened,
+                (surface_begin_ns - reopen_begin_ns) / 1e6, (now - surface_begin_ns) / 1e6);
+        startup_phase = STARTUP_DONE;
+    }
+    return 0;
+}
+
+/*
+ * Replace the closed window. Only per-window objects are destroyed and
+ * re-created; the EGL display, context, programs and fences stay.
+ */
+static void reopen_window() {
+    reopen_begin_ns = clock_now_ns(CLOCK_MONOTONIC);
+    destroy_egl_surface();
+    destroy_window();
+
+    /* The old surface's enter/leave state and unacked configure died with it */
+    struct output *output;
+    wl_list_for_each(output, &outputs, link) output->entered = false;
+    configure_ack_pending = false;
+    frame_ready = true;
+    last_target_ns = 0;
+    memset(damage_history, 0, sizeof(damage_history));
+    atomic_store(&closed, false);
+
+    window_configure_seq = atomic_load(&configure_seq);
+    create_window();
+    render_surface = wl_surface;
+    windows_reopened++;
+    startup_phase = STARTUP_REOPEN;
+}
+
+void client_options_init(struct client_options *options) {
+    memset(options, 0, sizeof(*options));
+    options->stats_interval = 5.0;
+    options->late_latch = true;
+    options->animate = true;
+    options->egl_thread = true;
+    options->max_frames_in_flight = 2;
+    options->timestep = ANIM_STEP_VARIABLE;
+}
+
+struct client *client_create(const struct client_options *options) {
+    if (instance) {
+        fprintf(stderr, "Only one client per process\n");
+        return NULL;
+    }
+
+    stats_interval = options->stats_interval;
+    late_latch = options->late_latch;
+    force_frame_callbacks = options->force_frame_callbacks;
+    present_mode = options->async_present ? PRESENT_ASYNC : PRESENT_VSYNC;
+    fullscreen = options->fullscreen;
+    animate = options->animate;
+    dispatch_thread_enabled = options->dispatch_thread;
+    egl_thread_enabled = options->egl_thread;
+    egl_thread_name = egl_thread_enabled ? "egl" : "main";
+    startup_report_path = options->startup_report;
+    exit_after_first_frame = options->exit_after_first_frame;
+    reopen_on_close = options->reopen && !exit_after_first_frame;
+    if (reopen_on_close && dispatch_thread_enabled) {
+        fprintf(stderr, "--reopen is not supported with --dispatch-thread, ignored\n");
+        reopen_on_close = false;
+    }
+    max_frames_in_flight = options->max_frames_in_flight;
+    anim_policy = options->timestep;
+
+    present_stats_reset(&present_total);
+    present_stats_reset(&present_interval);
+    present_stats_reset(&present_by_mode[PRESENT_VSYNC]);
+    present_stats_reset(&present_by_mode[PRESENT_ASYNC]);
+
+    startup_profile_init(&profile);
+    int phase = startup_profile_begin(&profile, "connect", "main");
+    display = wl_display_connect(NULL);
+    if (!display) {
+        fprintf(stderr, "Failed to connect to Wayland display\n");
+        return NULL;
+    }
+    startup_profile_end(&profile, phase);
+
+    /* With a dispatch thread the render loop switches to a private queue once running */
+    if (dispatch_thread_enabled) render_queue = wl_display_create_queue(display);
+    loop = event_loop_create(display, NULL);
+    frame_timer = loop ? event_loop_add_timer(loop, NULL, NULL) : NULL;
+    wakeup = loop ? event_loop_add_wakeup(loop, NULL, NULL) : NULL;
+    if (!frame_timer || !wakeup) {
+        fprintf(stderr, "Failed to set up the event loop\n");
+        if (wakeup) event_source_remove(wakeup);
+        if (frame_timer) event_source_remove(frame_timer);
+        if (loop) event_loop_destroy(loop);
+        if (render_queue) wl_event_queue_destroy(render_queue);
+        wl_display_disconnect(display);
+        wakeup = frame_timer = NULL;
+        loop = NULL;
+        render_queue = NULL;
+        display = NULL;
+        return NULL;
+    }
+    fprintf(stderr, "Event loop: %s\n", event_loop_backend(loop));
+
+    wl_list_init(&outputs);
+    cursor_init(&cursor);
+    registry = wl_display_get_registry(display);
+    wl_registry_add_listener(registry, &registry_listener, NULL);
+    startup_sync_request("registry");
+    event_loop_flush(loop);
+
+    /* Independent of the compositor: overlaps with the registry and configure round trips */
+    start_egl_init();
+
+    struct client *client = calloc(1, sizeof(*client));
+    /* Startup continues in client_dispatch(); the replies may already be waiting */
+    client->ready = true;
+    instance = client;
+    return client;
+}
+
+int client_get_fd(struct client *client) {
+    return event_loop_get_fd(loop);
+}
+
+int client_get_timeout(struct client *client) {
+    return client->ready ? 0 : -1;
+}
+
+/*
+ * Render one frame per frame callback or, in timed mode, keep
+ * TIMED_QUEUE_DEPTH frames queued for consecutive refreshes. An uncapped
+ * (async) frame returns to the host after every frame so its loop keeps
+ * running.
+ */
+int client_dispatch(struct client *client) {
+    if (atomic_load(&dispatch_failed) || event_loop_dispatch(loop, 0) < 0) {
+        fprintf(stderr, "Lost connection to Wayland display\n");
+        return -1;
+    }
+
+    if (startup_phase != STARTUP_DONE) {
+        if (startup_step(client) < 0) return -1;
+        if (startup_phase != STARTUP_DONE) {
+            client->ready = false;
+            client->needs_flush = true;
+            return 0;
+        }
+    }
+
+    while (true) {
+        bool again = client_step(client);
+        while (again && present_mode == PRESENT_VSYNC) again = client_step(client);
+        client->ready = again;
+
+        /* EGL reads the socket too: drain what it queued so the host can sleep */
+        int n = event_loop_dispatch_pending(loop);
+        if (n < 0) {
+            fprintf(stderr, "Lost connection to Wayland display\n");
+            return -1;
+        }
+        if (n == 0 || client->ready) break;
+    }
+
+    client->needs_flush = true;
+    if (!atomic_load(&closed)) return 0;
+    if (!reopen_on_close) return 1;
+    reopen_window();
+    client->ready = false;
+    return 0;
+}
+
+bool client_needs_flush(struct client *client) {
+    return client->needs_flush;
+}
+
+int client_flush(struct client *client) {
+    client->needs_flush = false;
+    return event_loop_flush(loop);
+}
+
+void client_toggle_present_mode(struct client *client) {
+    present_mode_toggle = 1;
+    event_source_wakeup_signal(wakeup);
+}
+
+const struct present_stats *client_get_present_stats(struct client *client) {
+    return presentation ? &present_total : NULL;
+}
+
+void client_request_screenshot(struct client *client) {
+    screenshot_requested = 1;
+    event_source_wakeup_signal(wakeup);
+}
+
+void client_destroy(struct client *client) {
+    if (dispatch_loop) stop_dispatch_thread();
+    if (startup_sync) wl_callback_destroy(startup_sync);
+    if (egl_thread_started) pthread_join(egl_thread, NULL);
+    if (decoration_manager) {
+        zxdg_decoration_manager_v1_destroy(decoration_manager);
+        decoration_manager = NULL;
+    }
+    if (render_presentation && render_presentation != presentation) wl_proxy_wrapper_destroy(render_presentation);
+    if (presentation) {
+        wp_presentation_destroy(presentation);
+        presentation = NULL;
+    }
+#ifdef HAVE_COMMIT_TIMING_V1
+    if (commit_timing_manager) wp_commit_timing_manager_v1_destroy(commit_timing_manager);
+#endif
+#ifdef HAVE_FIFO_V1
+    if (fifo_manager) wp_fifo_manager_v1_destroy(fifo_manager);
+#endif
+    if (tearing_manager) wp_tearing_control_manager_v1_destroy(tearing_manager);
+
+    destroy_egl();
+    destroy_window();
+    if (placeholder_buffer) wl_buffer_destroy(placeholder_buffer);
+    if (viewporter) wp_viewporter_destroy(viewporter);
+    if (single_pixel_manager) wp_single_pixel_buffer_manager_v1_destroy(single_pixel_manager);
+    cursor_finish(&cursor);
+    if (shm) wl_shm_destroy(shm);
+
+    if (xdg_wm) xdg_wm_base_destroy(xdg_wm);
+    struct output *output, *tmp;
+    wl_list_for_each_safe(output, tmp, &outputs, link) output_destroy(output);
+    if (compositor) wl_compositor_destroy(compositor);
+    if (registry) wl_registry_destroy(registry);
+    event_source_remove(wakeup);
+    event_source_remove(frame_timer);
+    event_loop_destroy(loop);
+    if (render_queue) wl_event_queue_destroy(render_queue);
+    if (display) wl_display_disconnect(display);
+    free(client);
+}
@@ -0,0 +1,90 @@
+/*
+ * client.h
+ * The Wayland + EGL client as an embeddable component.
+ *
+ * The client never blocks; a host loop drives it:
+ *
+ *     while (client_dispatch(client) == 0) {
+ *         if (client_needs_flush(client)) client_flush(client);
+ *         poll on client_get_fd() for reading, up to client_get_timeout() ms
+ *     }
+ *
+ * client_get_fd() is a single fd covering the Wayland socket, the frame
+ * timer and wake-ups, so the host needs no extra thread and never polls
+ * busily: the timeout is 0 only while an uncapped (async) frame loop runs.
+ *
+ * One client per process.
+ */
+
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <stdbool.h>
+
+#include "anim_clock.h"
+#include "present_stats.h"
+
+struct client;
+
+struct client_options {
+    double stats_interval;          /* seconds between presentation summaries, 0 disables */
+    bool late_latch;                /* start frames just before the predicted vblank */
+    bool force_frame_callbacks;     /* pace with frame callbacks even if fifo-v1 is available */
+    bool async_present;             /* start in async (tearing, uncapped) mode */
+    bool fullscreen;
+    bool animate;                   /* false: static background */
+    bool dispatch_thread;           /* read the socket on a separate thread */
+    bool egl_thread;                /* initialize EGL on a worker thread during startup */
+    const char *startup_report;     /* write startup phase timings as JSON here ("-": stdout) */
+    bool exit_after_first_frame;    /* close once the first frame is swapped (startup benchmarks) */
+    bool reopen;                    /* replace a closed window instead of quitting, reusing EGL state */
+    int max_frames_in_flight;       /* 1..FRAME_FENCES_MAX */
+    enum anim_step_policy timestep;
+};
+
+void client_options_init(struct client_options *options);
+
+/*
+ * Connect and start EGL initialization on a worker thread; NULL if the
+ * display is unavailable or the event loop cannot be set up.
+ * Does not wait for the compositor: the registry, window and EGL surface are
+ * set up by the following client_dispatch() calls as the replies arrive.
+ */
+struct client *client_create(const struct client_options *options);
+void client_destroy(struct client *client);
+
+int client_get_fd(struct client *client);
+
+/* How long the host may wait on client_get_fd(): 0 or -1 (until the fd is readable) */
+int client_get_timeout(struct client *client);
+
+/*
+ * Handle whatever is ready and render if it is time to. Never blocks and
+ * leaves no Wayland events queued. Returns 0 to continue, 1 once the window
+ * was closed, -1 if the connection failed, required globals are missing or
+ * EGL, the window surface or the dispatch thread could not be set up.
+ */
+int client_dispatch(struct client *client);
+
+/*
+ * Requests were queued since the last flush; flush before waiting. A flush
+ * that hits EAGAIN is parked: client_get_fd() then also turns readable when
+ * the socket drains, and client_dispatch() sends the rest.
+ */
+bool client_needs_flush(struct client *client);
+int client_flush(struct client *client);
+
+/* Switch between vsync and async presentation; async-signal safe */
+void client_toggle_present_mode(struct client *client);
+
+/* Write the next frame to screenshot-NNN.ppm in the working directory; async-signal safe */
+void client_request_screenshot(struct client *client);
+
+/*
+ * Presentation feedback accumulated since startup, including the most recent
+ * per-frame samples (present_stats_recent()). NULL without wp_presentation.
+ * Call from the thread that calls client_dispatch(); valid until the next call.
+ */
+const struct present_stats *client_get_present_stats(struct client *client);
+
+#endif /* CLIENT_H */
@@ -0,0 +1,196 @@
+/*
+ * cursor.c
+ * Pointer cursor, see cursor.h.
+ */
+
+#include "cursor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <wayland-cursor.h>
+#include "cursor-shape-v1-client-protocol.h"
+
+#define CURSOR_DEFAULT_SIZE 24
+
+struct cursor_seat {
+    struct wl_list link;
+    struct cursor *cursor;
+    uint32_t global_name;
+    struct wl_seat *seat;
+    struct wl_pointer *pointer;
+    struct wp_cursor_shape_device_v1 *shape_device;
+    bool inside;                /* pointer over our surface */
+    uint32_t enter_serial;
+};
+
+void cursor_init(struct cursor *cursor) {
+    *cursor = (struct cursor){ .scale = 1 };
+    wl_list_init(&cursor->seats);
+
+    cursor->theme_name = getenv("XCURSOR_THEME");
+    const char *size = getenv("XCURSOR_SIZE");
+    cursor->base_size = size ? atoi(size) : 0;
+    if (cursor->base_size <= 0) cursor->base_size = CURSOR_DEFAULT_SIZE;
+}
+
+/* Theme at size, loading it on first use; NULL if it cannot be loaded */
+static struct wl_cursor_theme *theme_for_size(struct cursor *cursor, int size) {
+    for (int i = 0; i < cursor->theme_count; i++) {
+        if (cursor->themes[i].size == size) return cursor->themes[i].theme;
+    }
+    if (cursor->theme_count == CURSOR_MAX_THEMES || !cursor->shm) return NULL;
+
+    struct wl_cursor_theme *theme = wl_cursor_theme_load(cursor->theme_name, size, cursor->shm);
+    if (!theme) {
+        fprintf(stderr, "Failed to load cursor theme %s at size %d\n",
+                cursor->theme_name ? cursor->theme_name : "(default)", size);
+        return NULL;
+    }
+    fprintf(stderr, "Cursor: loaded theme %s at size %d (no wp_cursor_shape_manager_v1)\n",
+            cursor->theme_name ? cursor->theme_name : "(default)", size);
+    cursor->themes[cursor->theme_count].size = size;
+    cursor->themes[cursor->theme_count].theme = theme;
+    cursor->theme_count++;
+    return theme;
+}
+
+/* Attach the theme's default cursor at the current scale to the cursor surface */
+static void set_theme_cursor(struct cursor_seat *cs) {
+    struct cursor *cursor = cs->cursor;
+    struct wl_cursor_theme *theme = theme_for_size(cursor, cursor->base_size * cursor->scale);
+    if (!theme) return;
+    struct wl_cursor *wl_cursor = wl_cursor_theme_get_cursor(theme, "default");
+    if (!wl_cursor) wl_cursor = wl_cursor_theme_get_cursor(theme, "left_ptr");
+    if (!wl_cursor || wl_cursor->image_count == 0) return;
+
+    if (!cursor->surface) cursor->surface = wl_compositor_create_surface(cursor->compositor);
+    struct wl_cursor_image *image = wl_cursor->images[0];
+    wl_surface_set_buffer_scale(cursor->surface, cursor->scale);
+    wl_surface_attach(cursor->surface, wl_cursor_image_get_buffer(image), 0, 0);
+    wl_surface_damage_buffer(cursor->surface, 0, 0, image->width, image->height);
+    wl_surface_commit(cursor->surface);
+    wl_pointer_set_cursor(cs->pointer, cs->enter_serial, cursor->surface,
+                          image->hotspot_x / cursor->scale, image->hotspot_y / cursor->scale);
+}
+
+static void pointer_enter(void *data, struct wl_pointer *pointer, uint32_t serial,
+                          struct wl_surface *surface, wl_fixed_t x, wl_fixed_t y) {
+    struct cursor_seat *cs = data;
+    cs->inside = true;
+    cs->enter_serial = serial;
+
+    if (cs->cursor->shape_manager && !cs->shape_device)
+        cs->shape_device = wp_cursor_shape_manager_v1_get_pointer(cs->cursor->shape_manager, pointer);
+    if (cs->shape_device)
+        wp_cursor_shape_device_v1_set_shape(cs->shape_device, serial, WP_CURSOR_SHAPE_DEVICE_V1_SHAPE_DEFAULT);
+    else
+        set_theme_cursor(cs);
+}
+
+static void pointer_leave(void *data, struct wl_pointer *pointer, uint32_t serial, struct wl_surface *surface) {
+    struct cursor_seat *cs = data;
+    cs->inside = false;
+}
+
+static void pointer_motion(void *data, struct wl_pointer *pointer, uint32_t time, wl_fixed_t x, wl_fixed_t y) {}
+static void pointer_button(void *data, struct wl_pointer *pointer, uint32_t serial, uint32_t time,
+                           uint32_t button, uint32_t state) {}
+static void pointer_axis(void *data, struct wl_pointer *pointer, uint32_t time, uint32_t axis, wl_fixed_t value) {}
+static void pointer_frame(void *data, struct wl_pointer *pointer) {}
+static void pointer_axis_source(void *data, struct wl_pointer *pointer, uint32_t source) {}
+static void pointer_axis_stop(void *data, struct wl_pointer *pointer, uint32_t time, uint32_t axis) {}
+static void pointer_axis_discrete(void *data, struct wl_pointer *pointer, uint32_t axis, int32_t discrete) {}
+
+/* Events up to wl_pointer v5 */
+static const struct wl_pointer_listener pointer_listener = {
+    .enter = pointer_enter,
+    .leave = pointer_leave,
+    .motion = pointer_motion,
+    .button = pointer_button,
+    .axis = pointer_axis,
+    .frame = pointer_frame,
+    .axis_source = pointer_axis_source,
+    .axis_stop = pointer_axis_stop,
+    .axis_discrete = pointer_axis_discrete,
+};
+
+static void release_pointer(struct cursor_seat *cs) {
+    if (cs->shape_device) wp_cursor_shape_device_v1_destroy(cs->shape_device);
+    if (cs->pointer && wl_pointer_get_version(cs->pointer) >= WL_POINTER_RELEASE_SINCE_VERSION)
+        wl_pointer_release(cs->pointer);
+    else if (cs->pointer)
+        wl_pointer_destroy(cs->pointer);
+    cs->shape_device = NULL;
+    cs->pointer = NULL;
+    cs->inside = false;
+}
+
+static void seat_capabilities(void *data, struct wl_seat *seat, uint32_t caps) {
+    struct cursor_seat *cs = data;
+    bool has_pointer = caps & WL_SEAT_CAPABILITY_POINTER;
+    if (has_pointer && !cs->pointer) {
+        cs->pointer = wl_seat_get_pointer(seat);
+        wl_pointer_add_listener(cs->pointer, &pointer_listener, cs);
+    } else if (!has_pointer && cs->pointer) {
+        release_pointer(cs);
+    }
+}
+
+static void seat_name(void *data, struct wl_seat *seat, const char *name) {}
+
+static const struct wl_seat_listener seat_listener = {
+    .capabilities = seat_capabilities,
+    .name = seat_name,
+};
+
+void cursor_add_seat(struct cursor *cursor, struct wl_seat *seat, uint32_t global_name) {
+    struct cursor_seat *cs = calloc(1, sizeof(*cs));
+    cs->cursor = cursor;
+    cs->global_name = global_name;
+    cs->seat = seat;
+    wl_seat_add_listener(seat, &seat_listener, cs);
+    wl_list_insert(&cursor->seats, &cs->link);
+}
+
+static void seat_destroy(struct cursor_seat *cs) {
+    release_pointer(cs);
+    if (wl_seat_get_version(cs->seat) >= WL_SEAT_RELEASE_SINCE_VERSION) wl_seat_release(cs->seat);
+    else wl_seat_destroy(cs->seat);
+    wl_list_remove(&cs->link);
+    free(cs);
+}
+
+bool cursor_remove_seat(struct cursor *cursor, uint32_t global_name) {
+    struct cursor_seat *cs;
+    wl_list_for_each(cs, &cursor->seats, link) {
+        if (cs->global_name == global_name) {
+            seat_destroy(cs);
+            return true;
+        }
+    }
+    return false;
+}
+
+void cursor_set_scale(struct cursor *cursor, int32_t scale) {
+    if (scale < 1) scale = 1;
+    if (scale == cursor->scale) return;
+    cursor->scale = scale;
+
+    /* Shape cursors are scaled by the compositor; theme cursors need a new buffer */
+    struct cursor_seat *cs;
+    wl_list_for_each(cs, &cursor->seats, link) {
+        if (cs->inside && !cs->shape_device) set_theme_cursor(cs);
+    }
+}
+
+void cursor_finish(struct cursor *cursor) {
+    struct cursor_seat *cs, *tmp;
+    wl_list_for_each_safe(cs, tmp, &cursor->seats, link) seat_destroy(cs);
+    if (cursor->surface) wl_surface_destroy(cursor->surface);
+    for (int i = 0; i < cursor->theme_count; i++) wl_cursor_theme_destroy(cursor->themes[i].theme);
+    if (cursor->shape_manager) wp_cursor_shape_manager_v1_destroy(cursor->shape_manager);
+    cursor->surface = NULL;
+    cursor->theme_count = 0;
+    cursor->shape_manager = NULL;
+}
@@ -0,0 +1,58 @@
+/*
+ * cursor.h
+ * Pointer cursor over the window, per seat.
+ *
+ * With wp_cursor_shape_manager_v1 the compositor draws the default shape
+ * from its own theme and the client loads no cursor images. Otherwise
+ * libwayland-cursor is the fallback, initialized on the first pointer enter:
+ * a theme is loaded only for a cursor size actually needed (base size times
+ * output scale) and kept for reuse. libwayland-cursor cannot load a single
+ * cursor, so each such size still reads the whole theme at that size.
+ *
+ * All calls must come from the thread that dispatches the seat's events.
+ */
+
+#ifndef CURSOR_H
+#define CURSOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-client.h>
+
+#define CURSOR_MAX_THEMES 4
+
+struct wl_cursor_theme;
+struct wp_cursor_shape_manager_v1;
+
+struct cursor {
+    /* Set by the owner once bound; shape_manager may stay NULL */
+    struct wl_compositor *compositor;
+    struct wl_shm *shm;
+    struct wp_cursor_shape_manager_v1 *shape_manager;
+
+    struct wl_list seats;       /* struct cursor_seat */
+    int32_t scale;
+
+    /* Fallback: XCURSOR_THEME / XCURSOR_SIZE, themes loaded per size */
+    const char *theme_name;
+    int base_size;
+    struct {
+        int size;
+        struct wl_cursor_theme *theme;
+    } themes[CURSOR_MAX_THEMES];
+    int theme_count;
+    struct wl_surface *surface;
+};
+
+void cursor_init(struct cursor *cursor);
+void cursor_finish(struct cursor *cursor);
+
+/* A wl_seat was bound; the pointer is created when the seat reports one */
+void cursor_add_seat(struct cursor *cursor, struct wl_seat *seat, uint32_t global_name);
+/* Returns false if global_name is not a seat */
+bool cursor_remove_seat(struct cursor *cursor, uint32_t global_name);
+
+/* Scale of the output the window is on; re-sets theme cursors already shown */
+void cursor_set_scale(struct cursor *cursor, int32_t scale);
+
+#endif /* CURSOR_H */
@@ -0,0 +1,70 @@
+/*
+ * damage.c
+ * Dirty region bookkeeping, see damage.h.
+ */
+
+#include "damage.h"
+
+static struct damage_rect rect_union(const struct damage_rect *a, const struct damage_rect *b) {
+    int32_t x1 = a->x < b->x ? a->x : b->x;
+    int32_t y1 = a->y < b->y ? a->y : b->y;
+    int32_t x2 = a->x + a->width > b->x + b->width ? a->x + a->width : b->x + b->width;
+    int32_t y2 = a->y + a->height > b->y + b->height ? a->y + a->height : b->y + b->height;
+    return (struct damage_rect){ x1, y1, x2 - x1, y2 - y1 };
+}
+
+static bool rect_contains(const struct damage_rect *outer, const struct damage_rect *inner) {
+    return inner->x >= outer->x && inner->y >= outer->y &&
+           inner->x + inner->width <= outer->x + outer->width &&
+           inner->y + inner->height <= outer->y + outer->height;
+}
+
+void damage_clear(struct damage *damage) {
+    damage->count = 0;
+}
+
+bool damage_empty(const struct damage *damage) {
+    return damage->count == 0;
+}
+
+void damage_add(struct damage *damage, int32_t x, int32_t y, int32_t width, int32_t height) {
+    struct damage_rect rect = { x, y, width, height };
+    if (width <= 0 || height <= 0) return;
+
+    for (int i = 0; i < damage->count; i++) {
+        if (rect_contains(&damage->rects[i], &rect)) return;
+    }
+
+    if (damage->count == DAMAGE_MAX_RECTS) {
+        struct damage_rect extents = damage_extents(damage);
+        damage->rects[0] = rect_union(&extents, &rect);
+        damage->count = 1;
+        return;
+    }
+    damage->rects[damage->count++] = rect;
+}
+
+void damage_union(struct damage *dst, const struct damage *src) {
+    for (int i = 0; i < src->count; i++) {
+        const struct damage_rect *r = &src->rects[i];
+        damage_add(dst, r->x, r->y, r->width, r->height);
+    }
+}
+
+struct damage_rect damage_extents(const struct damage *damage) {
+    if (damage->count == 0) return (struct damage_rect){ 0, 0, 0, 0 };
+
+    struct damage_rect extents = damage->rects[0];
+    for (int i = 1; i < damage->count; i++) extents = rect_union(&extents, &damage->rects[i]);
+    return extents;
+}
+
+bool damage_rect_intersect(const struct damage_rect *a, const struct damage_rect *b, struct damage_rect *out) {
+    int32_t x1 = a->x > b->x ? a->x : b->x;
+    int32_t y1 = a->y > b->y ? a->y : b->y;
+    int32_t x2 = a->x + a->width < b->x + b->width ? a->x + a->width : b->x + b->width;
+    int32_t y2 = a->y + a->height < b->y + b->height ? a->y + a->height : b->y + b->height;
+    if (x2 <= x1 || y2 <= y1) return false;
+    *out = (struct damage_rect){ x1, y1, x2 - x1, y2 - y1 };
+    return true;
+}
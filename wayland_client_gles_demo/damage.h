@@ -0,0 +1,38 @@
+/*
+ * damage.h
+ * Small damage (dirty region) accumulator.
+ *
+ * Rectangles are in surface coordinates with the origin at the top-left,
+ * like wl_surface.damage. Once DAMAGE_MAX_RECTS are used, further additions
+ * are folded into the bounding box of everything so far.
+ */
+
+#ifndef DAMAGE_H
+#define DAMAGE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DAMAGE_MAX_RECTS 8
+
+struct damage_rect {
+    int32_t x, y, width, height;
+};
+
+struct damage {
+    struct damage_rect rects[DAMAGE_MAX_RECTS];
+    int count;
+};
+
+void damage_clear(struct damage *damage);
+bool damage_empty(const struct damage *damage);
+void damage_add(struct damage *damage, int32_t x, int32_t y, int32_t width, int32_t height);
+void damage_union(struct damage *dst, const struct damage *src);
+
+/* Bounding box of all rectangles; zero-sized if empty */
+struct damage_rect damage_extents(const struct damage *damage);
+
+/* Intersection of two rectangles; false if they do not overlap */
+bool damage_rect_intersect(const struct damage_rect *a, const struct damage_rect *b, struct damage_rect *out);
+
+#endif /* DAMAGE_H */
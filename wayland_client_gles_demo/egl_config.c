@@ -0,0 +1,87 @@
+/*
+ * egl_config.c
+ * Scored EGL config selection, see egl_config.h.
+ */
+
+#include "egl_config.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static EGLint config_attrib(EGLDisplay display, EGLConfig config, EGLint attrib) {
+    EGLint value = 0;
+    eglGetConfigAttrib(display, config, attrib, &value);
+    return value;
+}
+
+/*
+ * Cost of a config that meets the request, lower is better: the memory
+ * traffic per pixel (color + depth + stencil, times the sample count)
+ * first, then slow (software) configs last, then the config id so the
+ * choice is stable.
+ */
+static uint64_t config_cost(EGLDisplay display, EGLConfig config) {
+    EGLint color = config_attrib(display, config, EGL_BUFFER_SIZE);
+    EGLint depth = config_attrib(display, config, EGL_DEPTH_SIZE);
+    EGLint stencil = config_attrib(display, config, EGL_STENCIL_SIZE);
+    EGLint samples = config_attrib(display, config, EGL_SAMPLES);
+    bool slow = config_attrib(display, config, EGL_CONFIG_CAVEAT) == EGL_SLOW_CONFIG;
+    uint64_t bits = (uint64_t)(color + depth + stencil) * (samples > 1 ? samples : 1);
+
+    return bits << 24 | (uint64_t)slow << 23 | (config_attrib(display, config, EGL_CONFIG_ID) & 0x7fffff);
+}
+
+/* eglChooseConfig treats sizes as minimums except samples; check exactness where it matters */
+static bool config_matches(EGLDisplay display, EGLConfig config, const struct egl_config_request *request) {
+    if (config_attrib(display, config, EGL_COLOR_BUFFER_TYPE) != EGL_RGB_BUFFER) return false;
+    if (request->alpha == 0 && config_attrib(display, config, EGL_ALPHA_SIZE) != 0) return false;
+    return config_attrib(display, config, EGL_SAMPLES) >= request->samples;
+}
+
+EGLConfig egl_config_choose(EGLDisplay display, const struct egl_config_request *request) {
+    EGLint attribs[] = {
+        EGL_SURFACE_TYPE, request->surface_type,
+        EGL_RENDERABLE_TYPE, request->renderable_type,
+        EGL_RED_SIZE, request->red,
+        EGL_GREEN_SIZE, request->green,
+        EGL_BLUE_SIZE, request->blue,
+        EGL_ALPHA_SIZE, request->alpha,
+        EGL_DEPTH_SIZE, request->depth,
+        EGL_STENCIL_SIZE, request->stencil,
+        EGL_NONE
+    };
+    EGLint n = 0;
+
+    if (!eglChooseConfig(display, attribs, NULL, 0, &n) || n == 0) return NULL;
+    EGLConfig *configs = calloc(n, sizeof(EGLConfig));
+    if (!configs) return NULL;
+    eglChooseConfig(display, attribs, configs, n, &n);
+
+    EGLConfig best = NULL;
+    uint64_t best_cost = UINT64_MAX;
+    for (EGLint i = 0; i < n; i++) {
+        if (!config_matches(display, configs[i], request)) continue;
+        uint64_t cost = config_cost(display, configs[i]);
+        if (cost < best_cost) {
+            best = configs[i];
+            best_cost = cost;
+        }
+    }
+    free(configs);
+    return best;
+}
+
+void egl_config_describe(EGLDisplay display, EGLConfig config, char *buf, size_t size) {
+    snprintf(buf, size, "id %d: rgba %d%d%d%d, depth %d, stencil %d, samples %d%s",
+             config_attrib(display, config, EGL_CONFIG_ID),
+             config_attrib(display, config, EGL_RED_SIZE),
+             config_attrib(display, config, EGL_GREEN_SIZE),
+             config_attrib(display, config, EGL_BLUE_SIZE),
+             config_attrib(display, config, EGL_ALPHA_SIZE),
+             config_attrib(display, config, EGL_DEPTH_SIZE),
+             config_attrib(display, config, EGL_STENCIL_SIZE),
+             config_attrib(display, config, EGL_SAMPLES),
+             config_attrib(display, config, EGL_CONFIG_CAVEAT) == EGL_SLOW_CONFIG ? " (slow)" : "");
+}
@@ -0,0 +1,32 @@
+/*
+ * egl_config.h
+ * Scored EGL config selection.
+ *
+ * eglChooseConfig() sorts larger color buffers first and does not penalize
+ * depth, stencil or multisample buffers the caller did not ask for, so its
+ * first result is often far bigger than needed. egl_config_choose() takes
+ * every config that meets the request and picks the one with the fewest
+ * bits per pixel.
+ */
+
+#ifndef EGL_CONFIG_H
+#define EGL_CONFIG_H
+
+#include <stddef.h>
+#include <EGL/egl.h>
+
+struct egl_config_request {
+    EGLint surface_type;        /* e.g. EGL_WINDOW_BIT */
+    EGLint renderable_type;     /* e.g. EGL_OPENGL_ES2_BIT */
+    EGLint red, green, blue, alpha;
+    EGLint depth, stencil;
+    EGLint samples;             /* 0: single sampled */
+};
+
+/* Smallest matching config, NULL if none matches */
+EGLConfig egl_config_choose(EGLDisplay display, const struct egl_config_request *request);
+
+/* One-line summary such as "id 12: rgba 8888, depth 0, stencil 0, samples 0" */
+void egl_config_describe(EGLDisplay display, EGLConfig config, char *buf, size_t size);
+
+#endif /* EGL_CONFIG_H */
@@ -0,0 +1,95 @@
+/*
+ * egl_device.c
+ * Process-wide EGL display and context, see egl_device.h.
+ */
+
+#include "egl_device.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <EGL/eglext.h>
+
+#include "egl_util.h"
+
+static pthread_mutex_t device_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct egl_device device_instance;
+
+struct egl_device *egl_device_acquire(struct wl_display *display, EGLDisplay egl_display) {
+    struct egl_device *device = &device_instance;
+
+    pthread_mutex_lock(&device_lock);
+    if (device->refs > 0 && device->wl_display != display) {
+        /* One connection per process, like the client itself */
+        pthread_mutex_unlock(&device_lock);
+        return NULL;
+    }
+    if (device->refs == 0) {
+        memset(device, 0, sizeof(*device));
+        device->display = egl_display;
+        if (device->display == EGL_NO_DISPLAY ||
+            !eglInitialize(device->display, &device->major, &device->minor)) {
+            pthread_mutex_unlock(&device_lock);
+            return NULL;
+        }
+        device->wl_display = display;
+        device->extensions = eglQueryString(device->display, EGL_EXTENSIONS);
+        device->no_config_context = egl_has_extension(device->extensions, "EGL_KHR_no_config_context") ||
+                                    egl_has_extension(device->extensions, "EGL_MESA_configless_context");
+        device->context = EGL_NO_CONTEXT;
+    }
+    device->refs++;
+    pthread_mutex_unlock(&device_lock);
+    return device;
+}
+
+void egl_device_release(struct egl_device *device) {
+    pthread_mutex_lock(&device_lock);
+    if (--device->refs == 0) {
+        eglMakeCurrent(device->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (device->context != EGL_NO_CONTEXT) eglDestroyContext(device->display, device->context);
+        eglTerminate(device->display);
+        memset(device, 0, sizeof(*device));
+    }
+    pthread_mutex_unlock(&device_lock);
+}
+
+static bool request_equal(const struct egl_config_request *a, const struct egl_config_request *b) {
+    return a->surface_type == b->surface_type && a->renderable_type == b->renderable_type &&
+           a->red == b->red && a->green == b->green && a->blue == b->blue && a->alpha == b->alpha &&
+           a->depth == b->depth && a->stencil == b->stencil && a->samples == b->samples;
+}
+
+EGLConfig egl_device_config(struct egl_device *device, const struct egl_config_request *request) {
+    pthread_mutex_lock(&device_lock);
+    EGLConfig config = NULL;
+    for (int i = 0; i < device->config_count; i++) {
+        if (request_equal(&device->configs[i].request, request)) {
+            config = device->configs[i].config;
+            break;
+        }
+    }
+    if (!config) {
+        config = egl_config_choose(device->display, request);
+        if (config && device->config_count < EGL_DEVICE_MAX_CONFIGS) {
+            device->configs[device->config_count].request = *request;
+            device->configs[device->config_count].config = config;
+            device->config_count++;
+        }
+    }
+    pthread_mutex_unlock(&device_lock);
+    return config;
+}
+
+EGLContext egl_device_context(struct egl_device *device, EGLConfig config) {
+    static const EGLint attribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+
+    pthread_mutex_lock(&device_lock);
+    if (device->context == EGL_NO_CONTEXT) {
+        device->context_config = device->no_config_context ? EGL_NO_CONFIG_KHR : config;
+        if (config) device->context = eglCreateContext(device->display, device->context_config, EGL_NO_CONTEXT, attribs);
+    }
+    EGLContext context = device->context;
+    if (!device->no_config_context && device->context_config != config) context = EGL_NO_CONTEXT;
+    pthread_mutex_unlock(&device_lock);
+    return context;
+}
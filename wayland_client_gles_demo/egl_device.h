@@ -0,0 +1,67 @@
+/*
+ * egl_device.h
+ * Process-wide EGL state shared by every window on a wl_display.
+ *
+ * One EGLDisplay, initialized once; one GLES2 context; and a table of the
+ * configs already chosen per request. With EGL_KHR_no_config_context the
+ * context has no config and can be made current with a surface of any
+ * config. Otherwise it is bound to the config it was first created for,
+ * and surfaces must use that config. A window then costs only its
+ * wl_egl_window and EGLSurface; eglInitialize and context creation are
+ * paid once per process, not per window.
+ *
+ * The device is reference counted and safe to acquire from any thread;
+ * the last release destroys the context and terminates the display.
+ */
+
+#ifndef EGL_DEVICE_H
+#define EGL_DEVICE_H
+
+#include <stdbool.h>
+#include <EGL/egl.h>
+
+#include "egl_config.h"
+
+#define EGL_DEVICE_MAX_CONFIGS 4
+
+struct wl_display;
+
+struct egl_device {
+    struct wl_display *wl_display;
+    EGLDisplay display;
+    EGLint major, minor;
+    const char *extensions;
+
+    EGLContext context;         /* EGL_NO_CONTEXT until egl_device_context() */
+    EGLConfig context_config;   /* NULL (EGL_NO_CONFIG_KHR) for a config-less context */
+    bool no_config_context;
+
+    struct {
+        struct egl_config_request request;
+        EGLConfig config;
+    } configs[EGL_DEVICE_MAX_CONFIGS];
+    int config_count;
+
+    int refs;
+};
+
+/*
+ * The device for display, initialized on first use; NULL if EGL cannot be
+ * initialized. egl_display is the caller's egl_get_wayland_display(display),
+ * so the lookup can be timed apart from eglInitialize; a device that already
+ * exists keeps its own (EGL returns the same handle for the same display).
+ */
+struct egl_device *egl_device_acquire(struct wl_display *display, EGLDisplay egl_display);
+void egl_device_release(struct egl_device *device);
+
+/* Config for request, chosen once (egl_config_choose) and cached; NULL if none matches */
+EGLConfig egl_device_config(struct egl_device *device, const struct egl_config_request *request);
+
+/*
+ * The shared GLES2 context, created on first use. Surfaces of config can be
+ * made current with it; EGL_NO_CONTEXT if creation failed or the context is
+ * bound to another config.
+ */
+EGLContext egl_device_context(struct egl_device *device, EGLConfig config);
+
+#endif /* EGL_DEVICE_H */
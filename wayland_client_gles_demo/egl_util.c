@@ -0,0 +1,33 @@
+/*
+ * egl_util.c
+ * Small EGL helpers, see egl_util.h.
+ */
+
+#include "egl_util.h"
+
+#include <string.h>
+#include <EGL/eglext.h>
+
+bool egl_has_extension(const char *extensions, const char *name) {
+    size_t len = strlen(name);
+    const char *p = extensions;
+    while (p && (p = strstr(p, name)) != NULL) {
+        if ((p == extensions || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0')) return true;
+        p += len;
+    }
+    return false;
+}
+
+EGLDisplay egl_get_wayland_display(struct wl_display *display) {
+    /* Client extensions; NULL on EGL 1.4 implementations without EGL_EXT_client_extensions */
+    const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+    if (egl_has_extension(extensions, "EGL_EXT_platform_base") &&
+        (egl_has_extension(extensions, "EGL_KHR_platform_wayland") ||
+         egl_has_extension(extensions, "EGL_EXT_platform_wayland"))) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (get_platform_display) return get_platform_display(EGL_PLATFORM_WAYLAND_KHR, display, NULL);
+    }
+    return eglGetDisplay((EGLNativeDisplayType)display);
+}
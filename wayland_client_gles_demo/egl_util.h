@@ -0,0 +1,24 @@
+/*
+ * egl_util.h
+ * Small EGL helpers shared by the rendering modules.
+ */
+
+#ifndef EGL_UTIL_H
+#define EGL_UTIL_H
+
+#include <stdbool.h>
+#include <EGL/egl.h>
+
+struct wl_display;
+
+/* Exact match of name in a space separated extension string */
+bool egl_has_extension(const char *extensions, const char *name);
+
+/*
+ * EGLDisplay for a Wayland connection through eglGetPlatformDisplayEXT, so
+ * the platform is not guessed from the pointer; falls back to eglGetDisplay
+ * without EGL_EXT_platform_base / EGL_*_platform_wayland.
+ */
+EGLDisplay egl_get_wayland_display(struct wl_display *display);
+
+#endif /* EGL_UTIL_H */
@@ -0,0 +1,646 @@
+/*
+ * event_loop.c
+ * Event loop with an epoll backend and, when built with HAVE_IO_URING, an
+ * io_uring backend; see event_loop.h.
+ *
+ * Both backends produce the same list of ready items per wait, so the
+ * Wayland read / dispatch sequence and the source callbacks are shared.
+ */
+
+#include "event_loop.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <wayland-client.h>
+
+#ifdef HAVE_IO_URING
+#include <liburing.h>
+
+#define URING_ENTRIES 64
+#endif
+
+#define MAX_EVENTS 16
+
+enum source_type {
+    SOURCE_FD,
+    SOURCE_TIMER,
+    SOURCE_WAKEUP,
+};
+
+#ifdef HAVE_IO_URING
+/* What an io_uring completion belongs to; first member of its owner */
+enum uring_op_kind {
+    URING_OP_DISPLAY_IN,
+    URING_OP_DISPLAY_OUT,
+    URING_OP_SOURCE,
+    URING_OP_WRITE,
+};
+
+struct uring_op {
+    enum uring_op_kind kind;
+    bool armed;                 /* submitted (or queued) and not completed yet */
+};
+#endif
+
+struct event_source {
+#ifdef HAVE_IO_URING
+    struct uring_op op;
+    bool removed;               /* freed when its cancelled operation completes */
+    struct event_source *next_removed;
+#endif
+    struct event_loop *loop;
+    enum source_type type;
+    int fd;
+    uint32_t events;
+    event_source_fn fn;
+    void *data;
+};
+
+struct event_write {
+#ifdef HAVE_IO_URING
+    struct uring_op op;
+#endif
+    int fd;
+    const uint8_t *buf;
+    size_t len;
+    size_t done;
+    uint64_t offset;
+    event_write_fn fn;
+    void *data;
+};
+
+/* One ready item of a wait: the display (source and write NULL), a source or a finished write */
+struct ready {
+    struct event_source *source;
+    struct event_write *write;
+    uint32_t events;            /* EPOLL* bits for the display and fd sources */
+    ssize_t result;             /* writes: bytes written or -errno */
+};
+
+struct event_loop {
+    struct wl_display *display;
+    struct wl_event_queue *queue;   /* NULL: this loop reads the socket */
+    int epoll_fd;                   /* -1 with io_uring */
+    bool flush_parked;              /* socket full: the rest waits for EPOLLOUT */
+    struct event_loop_flush_stats flush_stats;
+#ifdef HAVE_IO_URING
+    struct io_uring *ring;          /* NULL: epoll backend */
+    struct uring_op display_in;
+    struct uring_op display_out;
+    struct event_source *removed;   /* removed sources whose operation is still in flight */
+    unsigned writes_in_flight;      /* submitted writes whose callback has not run yet */
+    bool source_failed;             /* a timer / wake-up poll failed: the loop cannot wait */
+#endif
+};
+
+static void run_ready(struct ready *ready, int n);
+
+/* Drain the expiration / wake-up counter so the fd stops polling ready */
+static void drain_counter(int fd) {
+    uint64_t count;
+    ssize_t ret = read(fd, &count, sizeof(count));
+    (void)ret;
+}
+
+#ifdef HAVE_IO_URING
+static int uring_wait_ready(struct event_loop *loop, int timeout_ms, struct ready *ready);
+
+static struct io_uring_sqe *uring_get_sqe(struct event_loop *loop) {
+    struct io_uring_sqe *sqe = io_uring_get_sqe(loop->ring);
+    if (!sqe) {
+        /* Submission queue full: hand the batch to the kernel early */
+        io_uring_submit(loop->ring);
+        sqe = io_uring_get_sqe(loop->ring);
+    }
+    return sqe;
+}
+
+/* Queue (not submit) the operation that reports the next readiness of a source */
+static void uring_arm_source(struct event_source *source) {
+    struct io_uring_sqe *sqe = uring_get_sqe(source->loop);
+    if (!sqe) return;
+    /*
+     * Timers and wake-ups too are polled and then read(): a ring read of the
+     * non-blocking counter completes at once with -EAGAIN where the file has
+     * no nowait support (timerfd before 6.10, any O_NONBLOCK file before 5.18)
+     */
+    io_uring_prep_poll_add(sqe, source->fd, source->events);
+    io_uring_sqe_set_data(sqe, &source->op);
+    source->op.armed = true;
+}
+
+static void uring_arm_display(struct event_loop *loop, struct uring_op *op, uint32_t events) {
+    if (op->armed) return;
+    struct io_uring_sqe *sqe = uring_get_sqe(loop);
+    if (!sqe) return;
+    io_uring_prep_poll_add(sqe, wl_display_get_fd(loop->display), events);
+    io_uring_sqe_set_data(sqe, op);
+    op->armed = true;
+}
+
+static void uring_submit_write(struct event_loop *loop, struct event_write *write) {
+    struct io_uring_sqe *sqe = uring_get_sqe(loop);
+    if (!sqe) {
+        if (write->fn) write->fn(write->data, -EBUSY);
+        free(write);
+        loop->writes_in_flight--;
+        return;
+    }
+    io_uring_prep_write(sqe, write->fd, write->buf + write->done, write->len - write->done,
+                        write->offset + write->done);
+    io_uring_sqe_set_data(sqe, &write->op);
+    write->op.armed = true;
+}
+
+/* The ring needs poll and write; older kernels fall back to epoll */
+static struct io_uring *uring_create() {
+    struct io_uring *ring = calloc(1, sizeof(*ring));
+    if (io_uring_queue_init(URING_ENTRIES, ring, 0) < 0) {
+        free(ring);
+        return NULL;
+    }
+    struct io_uring_probe *probe = io_uring_get_probe_ring(ring);
+    bool supported = probe &&
+                     io_uring_opcode_supported(probe, IORING_OP_POLL_ADD) &&
+                     io_uring_opcode_supported(probe, IORING_OP_WRITE);
+    if (probe) io_uring_free_probe(probe);
+    if (!supported) {
+        io_uring_queue_exit(ring);
+        free(ring);
+        return NULL;
+    }
+    return ring;
+}
+#endif
+
+struct event_loop *event_loop_create(struct wl_display *display, struct wl_event_queue *queue) {
+    struct event_loop *loop = calloc(1, sizeof(*loop));
+    loop->display = display;
+    loop->queue = queue;
+    loop->epoll_fd = -1;
+
+#ifdef HAVE_IO_URING
+    loop->ring = uring_create();
+    if (loop->ring) {
+        loop->display_in.kind = URING_OP_DISPLAY_IN;
+        loop->display_out.kind = URING_OP_DISPLAY_OUT;
+        /* The display poll is armed before each wait */
+        return loop;
+    }
+#endif
+
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        free(loop);
+        return NULL;
+    }
+    if (queue) return loop;
+
+    /* The display is the only source registered with a NULL pointer */
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, wl_display_get_fd(display), &ev) < 0) {
+        close(loop->epoll_fd);
+        free(loop);
+        return NULL;
+    }
+    return loop;
+}
+
+void event_loop_destroy(struct event_loop *loop) {
+#ifdef HAVE_IO_URING
+    if (loop->ring) {
+        /*
+         * Let pending writes finish so their callbacks release the buffers, and
+         * collect the cancels of removed sources; the ring exit drops the rest
+         */
+        struct ready ready[MAX_EVENTS];
+        while (loop->writes_in_flight || loop->removed) {
+            int n = uring_wait_ready(loop, -1, ready);
+            if (n < 0) break;
+            for (int i = 0; i < n; i++) {
+                if (ready[i].write) run_ready(&ready[i], 1);
+            }
+        }
+        io_uring_queue_exit(loop->ring);
+        free(loop->ring);
+        while (loop->removed) {
+            struct event_source *next = loop->removed->next_removed;
+            free(loop->removed);
+            loop->removed = next;
+        }
+    }
+#endif
+    if (loop->epoll_fd >= 0) close(loop->epoll_fd);
+    free(loop);
+}
+
+const char *event_loop_backend(struct event_loop *loop) {
+#ifdef HAVE_IO_URING
+    if (loop->ring) return "io_uring";
+#endif
+    return "epoll";
+}
+
+static struct event_source *add_source(struct event_loop *loop, enum source_type type, int fd,
+                                       uint32_t events, event_source_fn fn, void *data) {
+    if (fd < 0) return NULL;
+
+    struct event_source *source = calloc(1, sizeof(*source));
+    source->loop = loop;
+    source->type = type;
+    source->fd = fd;
+    source->events = events;
+    source->fn = fn;
+    source->data = data;
+
+#ifdef HAVE_IO_URING
+    if (loop->ring) {
+        source->op.kind = URING_OP_SOURCE;
+        uring_arm_source(source);
+        return source;
+    }
+#endif
+
+    struct epoll_event ev = { .events = events, .data.ptr = source };
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        if (type != SOURCE_FD) close(fd);
+        free(source);
+        return NULL;
+    }
+    return source;
+}
+
+struct event_source *event_loop_add_fd(struct event_loop *loop, int fd, uint32_t events,
+                                       event_source_fn fn, void *data) {
+    return add_source(loop, SOURCE_FD, fd, events, fn, data);
+}
+
+struct event_source *event_loop_add_timer(struct event_loop *loop, event_source_fn fn, void *data) {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    return add_source(loop, SOURCE_TIMER, fd, EPOLLIN, fn, data);
+}
+
+struct event_source *event_loop_add_wakeup(struct event_loop *loop, event_source_fn fn, void *data) {
+    int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    return add_source(loop, SOURCE_WAKEUP, fd, EPOLLIN, fn, data);
+}
+
+void event_source_remove(struct event_source *source) {
+    struct event_loop *loop = source->loop;
+
+#ifdef HAVE_IO_URING
+    if (loop->ring) {
+        if (source->type != SOURCE_FD) close(source->fd);
+        if (!source->op.armed) {
+            free(source);
+            return;
+        }
+        /* The ring still references the source: free it once the cancel completes */
+        struct io_uring_sqe *sqe = uring_get_sqe(loop);
+        if (sqe) {
+            io_uring_prep_cancel(sqe, &source->op, 0);
+            /* The cancel's own completion must not be mistaken for an operation */
+            io_uring_sqe_set_data(sqe, NULL);
+        }
+        source->removed = true;
+        source->next_removed = loop->removed;
+        loop->removed = source;
+        return;
+    }
+#endif
+
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
+    /* fds handed in by the caller stay open; timerfd/eventfd belong to us */
+    if (source->type != SOURCE_FD) close(source->fd);
+    free(source);
+}
+
+int event_source_timer_update(struct event_source *source, uint64_t when_ns) {
+    struct itimerspec its = {
+        .it_value = {
+            .tv_sec = when_ns / 1000000000ull,
+            .tv_nsec = when_ns % 1000000000ull,
+        },
+    };
+    return timerfd_settime(source->fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+void event_source_wakeup_signal(struct event_source *source) {
+    uint64_t one = 1;
+    ssize_t ret = write(source->fd, &one, sizeof(one));
+    (void)ret;
+}
+
+int event_loop_write(struct event_loop *loop, int fd, const void *buf, size_t len, uint64_t offset,
+                     event_write_fn fn, void *data) {
+#ifdef HAVE_IO_URING
+    if (loop->ring) {
+        struct event_write *write = calloc(1, sizeof(*write));
+        write->op.kind = URING_OP_WRITE;
+        write->fd = fd;
+        write->buf = buf;
+        write->len = len;
+        write->offset = offset;
+        write->fn = fn;
+        write->data = data;
+        loop->writes_in_flight++;
+        /* Goes out with the next submission, together with the rest of the frame */
+        uring_submit_write(loop, write);
+        return 0;
+    }
+#endif
+
+    /* epoll cannot wait for regular files: write synchronously */
+    size_t done = 0;
+    while (done < len) {
+        ssize_t ret = pwrite(fd, (const uint8_t *)buf + done, len - done, offset + done);
+        if (ret < 0 && errno == EINTR) continue;
+        if (ret <= 0) {
+            int err = ret < 0 ? errno : EIO;
+            if (fn) fn(data, -err);
+            return 0;
+        }
+        done += ret;
+    }
+    if (fn) fn(data, (ssize_t)done);
+    return 0;
+}
+
+/* Watch the display fd for writability while a flush is parked */
+static int watch_display_out(struct event_loop *loop, bool out) {
+#ifdef HAVE_IO_URING
+    if (loop->ring) {
+        /* A stale POLLOUT completion after un-parking is ignored */
+        if (out) uring_arm_display(loop, &loop->display_out, EPOLLOUT);
+        return 0;
+    }
+#endif
+
+    int fd = wl_display_get_fd(loop->display);
+    struct epoll_event ev = { .events = out ? EPOLLOUT : 0, .data.ptr = NULL };
+
+    if (loop->queue) {
+        /* This loop does not watch the socket otherwise */
+        return epoll_ctl(loop->epoll_fd, out ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, fd, &ev);
+    }
+    ev.events |= EPOLLIN;
+    return epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+static int flush_display(struct event_loop *loop) {
+    loop->flush_stats.flushes++;
+    if (wl_display_flush(loop->display) >= 0) {
+        if (loop->flush_parked) {
+            watch_display_out(loop, false);
+            loop->flush_parked = false;
+        }
+        return 0;
+    }
+    if (errno != EAGAIN) return -1;
+
+    /* The compositor is not reading: keep the rest buffered instead of retrying */
+    loop->flush_stats.backpressure++;
+    if (!loop->flush_parked) {
+        if (watch_display_out(loop, true) < 0) return -1;
+        loop->flush_parked = true;
+    }
+    return 0;
+}
+
+int event_loop_flush(struct event_loop *loop) {
+#ifdef HAVE_IO_URING
+    /* One submission for everything queued since the last wait */
+    if (loop->ring && io_uring_sq_ready(loop->ring) > 0) io_uring_submit(loop->ring);
+#endif
+    /* While parked the rest goes out when the display polls writable */
+    if (loop->flush_parked) return 0;
+    return flush_display(loop);
+}
+
+void event_loop_get_flush_stats(struct event_loop *loop, struct event_loop_flush_stats *stats) {
+    *stats = loop->flush_stats;
+}
+
+static int epoll_wait_ready(struct event_loop *loop, int timeout_ms, struct ready *ready) {
+    struct epoll_event events[MAX_EVENTS];
+    int n = epoll_wait(loop->epoll_fd, events, MAX_EVENTS, timeout_ms);
+    if (n < 0) return errno == EINTR ? 0 : -1;
+
+    for (int i = 0; i < n; i++) {
+        struct event_source *source = events[i].data.ptr;
+        ready[i] = (struct ready){ .source = source, .events = events[i].events };
+        if (source && source->type != SOURCE_FD) drain_counter(source->fd);
+    }
+    return n;
+}
+
+#ifdef HAVE_IO_URING
+/* Submit everything queued and wait for completions in one io_uring_enter() */
+static int uring_wait_ready(struct event_loop *loop, int timeout_ms, struct ready *ready) {
+    int ret;
+    if (loop->source_failed) return -1;
+    if (!loop->queue) uring_arm_display(loop, &loop->display_in, EPOLLIN);
+
+    if (timeout_ms < 0) {
+        ret = io_uring_submit_and_wait(loop->ring, 1);
+    } else if (timeout_ms == 0) {
+        ret = io_uring_submit(loop->ring);
+    } else {
+        struct __kernel_timespec ts = {
+            .tv_sec = timeout_ms / 1000,
+            .tv_nsec = (timeout_ms % 1000) * 1000000ll,
+        };
+        struct io_uring_cqe *cqe;
+        ret = io_uring_submit_and_wait_timeout(loop->ring, &cqe, 1, &ts, NULL);
+    }
+    if (ret < 0 && ret != -ETIME && ret != -EINTR) return -1;
+
+    struct io_uring_cqe *cqes[MAX_EVENTS];
+    unsigned count = io_uring_peek_batch_cqe(loop->ring, cqes, MAX_EVENTS);
+    int n = 0;
+    for (unsigned i = 0; i < count; i++) {
+        struct uring_op *op = io_uring_cqe_get_data(cqes[i]);
+        int res = cqes[i]->res;
+        if (!op) continue;  /* cancel requests */
+        op->armed = false;
+
+        switch (op->kind) {
+        case URING_OP_DISPLAY_IN:
+            /* Stale once the loop switched to consuming a queue */
+            if (res > 0 && !loop->queue) ready[n++] = (struct ready){ .events = (uint32_t)res };
+            break;
+        case URING_OP_DISPLAY_OUT:
+            if (res > 0 && loop->flush_parked) ready[n++] = (struct ready){ .events = EPOLLOUT };
+            break;
+        case URING_OP_SOURCE: {
+            struct event_source *source = (struct event_source *)op;
+            if (source->removed) {
+                struct event_source **link = &loop->removed;
+                while (*link != source) link = &(*link)->next_removed;
+                *link = source->next_removed;
+                free(source);
+                break;
+            }
+            if (res < 0) {
+                /* Not re-armed, it would fail again at once: fd sources see an error
+                   like with epoll, a dead timer or wake-up fails the next wait */
+                if (source->type == SOURCE_FD) {
+                    ready[n++] = (struct ready){ .source = source, .events = EPOLLERR };
+                } else {
+                    fprintf(stderr, "io_uring poll of a timer / wake-up failed: %s\n", strerror(-res));
+                    loop->source_failed = true;
+                }
+                break;
+            }
+            if (source->type != SOURCE_FD) drain_counter(source->fd);
+            /* Re-armed now, submitted with the next wait after the callback ran */
+            uring_arm_source(source);
+            ready[n++] = (struct ready){ .source = source,
+                                         .events = source->type == SOURCE_FD ? (uint32_t)res : 0 };
+            break;
+        }
+        case URING_OP_WRITE: {
+            struct event_write *write = (struct event_write *)op;
+            if (res > 0 && write->done + res < write->len) {
+                write->done += res;
+                uring_submit_write(loop, write);
+                break;
+            }
+            if (res >= 0) write->done += res;
+            loop->writes_in_flight--;
+            ready[n++] = (struct ready){ .write = write, .result = res < 0 ? res : (ssize_t)write->done };
+            break;
+        }
+        }
+    }
+    io_uring_cq_advance(loop->ring, count);
+    return n;
+}
+#endif
+
+static int wait_ready(struct event_loop *loop, int timeout_ms, struct ready *ready) {
+#ifdef HAVE_IO_URING
+    if (loop->ring) return uring_wait_ready(loop, timeout_ms, ready);
+#endif
+    return epoll_wait_ready(loop, timeout_ms, ready);
+}
+
+/* The display became writable: send what a parked flush left behind */
+static int handle_display_out(struct event_loop *loop, struct ready *ready, int n) {
+    for (int i = 0; i < n; i++) {
+        if (ready[i].source || ready[i].write || !(ready[i].events & EPOLLOUT)) continue;
+        loop->flush_stats.pollout_wakeups++;
+        return flush_display(loop);
+    }
+    return 0;
+}
+
+static void run_ready(struct ready *ready, int n) {
+    for (int i = 0; i < n; i++) {
+        struct event_source *source = ready[i].source;
+        struct event_write *write = ready[i].write;
+
+        if (write) {
+            if (write->fn) write->fn(write->data, ready[i].result);
+            free(write);
+        } else if (source && source->fn) {
+            source->fn(source->data, source->type == SOURCE_FD ? ready[i].events : 0);
+        }
+    }
+}
+
+/* Consumer of a private queue: another thread reads the socket and wakes us */
+static int dispatch_queue(struct event_loop *loop, int timeout_ms) {
+    int ret = wl_display_dispatch_queue_pending(loop->display, loop->queue);
+    if (ret < 0) return -1;
+    if (ret > 0) timeout_ms = 0;
+    if (timeout_ms != 0 && event_loop_flush(loop) < 0) return -1;
+
+    struct ready ready[MAX_EVENTS];
+    int n = wait_ready(loop, timeout_ms, ready);
+    if (n < 0) return -1;
+    if (handle_display_out(loop, ready, n) < 0) return -1;
+
+    if (wl_display_dispatch_queue_pending(loop->display, loop->queue) < 0) return -1;
+    run_ready(ready, n);
+    return 0;
+}
+
+int event_loop_dispatch(struct event_loop *loop, int timeout_ms) {
+    struct wl_display *display = loop->display;
+
+    if (loop->queue) return dispatch_queue(loop, timeout_ms);
+
+    /* Only block once the default queue is empty and this thread is the reader;
+       events that were already queued are progress, so do not block after them */
+    while (wl_display_prepare_read(display) != 0) {
+        int ret = wl_display_dispatch_pending(display);
+        if (ret < 0) return -1;
+        if (ret > 0) timeout_ms = 0;
+    }
+    /* Flush only before sleeping, so all requests of a frame leave in one batch */
+    if (timeout_ms != 0 && event_loop_flush(loop) < 0) {
+        wl_display_cancel_read(display);
+        return -1;
+    }
+
+    struct ready ready[MAX_EVENTS];
+    int n = wait_ready(loop, timeout_ms, ready);
+    if (n < 0) {
+        wl_display_cancel_read(display);
+        return -1;
+    }
+
+    bool display_ready = false;
+    for (int i = 0; i < n; i++) {
+        if (!ready[i].source && !ready[i].write && (ready[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+            display_ready = true;
+    }
+    if (handle_display_out(loop, ready, n) < 0) {
+        wl_display_cancel_read(display);
+        return -1;
+    }
+    if (display_ready) {
+        if (wl_display_read_events(display) < 0) return -1;
+    } else {
+        wl_display_cancel_read(display);
+    }
+    if (wl_display_dispatch_pending(display) < 0) return -1;
+
+    run_ready(ready, n);
+    return 0;
+}
+
+void event_loop_set_queue(struct event_loop *loop, struct wl_event_queue *queue) {
+    loop->queue = queue;
+#ifdef HAVE_IO_URING
+    if (loop->ring) return;
+#endif
+    /* Keep watching the socket only for a parked flush */
+    int fd = wl_display_get_fd(loop->display);
+    struct epoll_event ev = { .events = EPOLLOUT, .data.ptr = NULL };
+    if (loop->flush_parked) epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    else epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+int event_loop_dispatch_pending(struct event_loop *loop) {
+    if (loop->queue) return wl_display_dispatch_queue_pending(loop->display, loop->queue);
+    return wl_display_dispatch_pending(loop->display);
+}
+
+int event_loop_get_fd(struct event_loop *loop) {
+#ifdef HAVE_IO_URING
+    /* The ring fd polls readable while completions are waiting */
+    if (loop->ring) return loop->ring->ring_fd;
+#endif
+    return loop->epoll_fd;
+}
@@ -0,0 +1,112 @@
+/*
+ * event_loop.h
+ * Single-threaded event loop around the Wayland display fd.
+ *
+ * event_loop_dispatch() is the one place the client blocks: it follows the
+ * wl_display prepare_read / read_events / cancel_read protocol around a
+ * single epoll_wait() that also covers timers (timerfd) and cross-thread or
+ * signal-handler wake-ups (eventfd). A host with its own loop polls
+ * event_loop_get_fd() instead and calls event_loop_dispatch() with timeout 0.
+ *
+ * Built with HAVE_IO_URING (CMake option WCD_USE_IO_URING) the loop uses an
+ * io_uring instead when the kernel supports it: the display, timers and
+ * wake-ups are watched with poll operations, and file writes run
+ * asynchronously.
+ * Everything queued during a frame goes to the kernel in one submission,
+ * combined with the wait. Without kernel support it falls back to epoll.
+ *
+ * A loop created for a separate wl_event_queue does not read the socket at
+ * all: another thread reads and signals one of its wake-up sources, and the
+ * loop only dispatches that queue.
+ */
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+struct wl_display;
+struct wl_event_queue;
+struct event_loop;
+struct event_source;
+
+/* Source callback; events are EPOLL* bits for fd sources, 0 otherwise */
+typedef void (*event_source_fn)(void *data, uint32_t events);
+
+/* Write completion; result is the number of bytes written or -errno */
+typedef void (*event_write_fn)(void *data, ssize_t result);
+
+/* queue NULL: read the socket and dispatch the default queue */
+struct event_loop *event_loop_create(struct wl_display *display, struct wl_event_queue *queue);
+void event_loop_destroy(struct event_loop *loop);
+
+/*
+ * Switch a loop that reads the socket to consuming queue only, for when
+ * another thread takes over reading. The loop fd stays the same.
+ */
+void event_loop_set_queue(struct event_loop *loop, struct wl_event_queue *queue);
+
+/* "io_uring" or "epoll" */
+const char *event_loop_backend(struct event_loop *loop);
+
+/* Watch an arbitrary fd for EPOLLIN/EPOLLOUT */
+struct event_source *event_loop_add_fd(struct event_loop *loop, int fd, uint32_t events,
+                                       event_source_fn fn, void *data);
+
+/* Timer on CLOCK_MONOTONIC; armed with event_source_timer_update() */
+struct event_source *event_loop_add_timer(struct event_loop *loop, event_source_fn fn, void *data);
+
+/* Wake-up source; event_source_wakeup_signal() is async-signal and thread safe */
+struct event_source *event_loop_add_wakeup(struct event_loop *loop, event_source_fn fn, void *data);
+
+void event_source_remove(struct event_source *source);
+
+/* Fire once at the absolute CLOCK_MONOTONIC time when_ns; 0 disarms */
+int event_source_timer_update(struct event_source *source, uint64_t when_ns);
+void event_source_wakeup_signal(struct event_source *source);
+
+/*
+ * Write len bytes of buf to fd at offset; buf must stay valid until fn runs.
+ * With io_uring the write is submitted with the next flush or wait and fn
+ * runs from event_loop_dispatch(); with epoll it is written synchronously
+ * and fn runs before this returns.
+ */
+int event_loop_write(struct event_loop *loop, int fd, const void *buf, size_t len, uint64_t offset,
+                     event_write_fn fn, void *data);
+
+/*
+ * Flush (unless timeout_ms is 0), wait up to timeout_ms (-1: forever) for
+ * the display or any source, read and dispatch Wayland events, then run the
+ * callbacks of ready sources. Does not block if events were already queued.
+ * Returns -1 if the Wayland connection failed.
+ */
+int event_loop_dispatch(struct event_loop *loop, int timeout_ms);
+
+/*
+ * Flush policy: requests are written once, right before the loop (or the
+ * host) goes to sleep, so everything a frame produced leaves in one batch.
+ * If the socket is full (EAGAIN) the rest stays buffered in libwayland and
+ * the loop watches the display for EPOLLOUT, finishing the flush from
+ * event_loop_dispatch() once the compositor has caught up; until then this
+ * does not touch the socket. Also submits queued io_uring operations.
+ * Returns -1 only on a fatal socket error.
+ */
+int event_loop_flush(struct event_loop *loop);
+
+struct event_loop_flush_stats {
+    uint64_t flushes;
+    uint64_t backpressure;      /* flushes that hit EAGAIN */
+    uint64_t pollout_wakeups;   /* parked flushes resumed on EPOLLOUT */
+};
+void event_loop_get_flush_stats(struct event_loop *loop, struct event_loop_flush_stats *stats);
+
+/* Dispatch events already queued without reading; returns how many, -1 on error */
+int event_loop_dispatch_pending(struct event_loop *loop);
+
+/* The epoll (or io_uring) fd: polls readable whenever event_loop_dispatch() has work */
+int event_loop_get_fd(struct event_loop *loop);
+
+#endif /* EVENT_LOOP_H */
@@ -0,0 +1,75 @@
+/*
+ * frame_fences.c
+ * Frames-in-flight limit on top of EGL_KHR_fence_sync, see frame_fences.h.
+ */
+
+#include "frame_fences.h"
+#include "egl_util.h"
+
+#include <string.h>
+#include <time.h>
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+bool frame_fences_init(struct frame_fences *fences, EGLDisplay display, int limit) {
+    memset(fences, 0, sizeof(*fences));
+
+    if (!egl_has_extension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_fence_sync")) return false;
+
+    fences->create_sync = (PFNEGLCREATESYNCKHRPROC)eglGetProcAddress("eglCreateSyncKHR");
+    fences->client_wait_sync = (PFNEGLCLIENTWAITSYNCKHRPROC)eglGetProcAddress("eglClientWaitSyncKHR");
+    fences->destroy_sync = (PFNEGLDESTROYSYNCKHRPROC)eglGetProcAddress("eglDestroySyncKHR");
+    if (!fences->create_sync || !fences->client_wait_sync || !fences->destroy_sync) return false;
+
+    fences->display = display;
+    fences->limit = limit < 1 ? 1 : limit > FRAME_FENCES_MAX ? FRAME_FENCES_MAX : limit;
+    return true;
+}
+
+static void retire_oldest(struct frame_fences *fences) {
+    fences->destroy_sync(fences->display, fences->fences[fences->head]);
+    fences->fences[fences->head] = EGL_NO_SYNC_KHR;
+    fences->head = (fences->head + 1) % FRAME_FENCES_MAX;
+    fences->count--;
+}
+
+void frame_fences_finish(struct frame_fences *fences) {
+    while (fences->count > 0) retire_oldest(fences);
+    fences->display = EGL_NO_DISPLAY;
+}
+
+void frame_fences_throttle(struct frame_fences *fences) {
+    if (fences->display == EGL_NO_DISPLAY) return;
+
+    /* Retire whatever the GPU already finished, without blocking */
+    while (fences->count > 0 &&
+           fences->client_wait_sync(fences->display, fences->fences[fences->head], 0, 0) == EGL_CONDITION_SATISFIED_KHR)
+        retire_oldest(fences);
+
+    if (fences->count < fences->limit) return;
+
+    uint64_t start = now_ns();
+    fences->client_wait_sync(fences->display, fences->fences[fences->head],
+                             EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, EGL_FOREVER_KHR);
+    uint64_t waited = now_ns() - start;
+    retire_oldest(fences);
+
+    fences->waits++;
+    fences->wait_ns += waited;
+    if (waited > fences->max_wait_ns) fences->max_wait_ns = waited;
+}
+
+void frame_fences_insert(struct frame_fences *fences) {
+    if (fences->display == EGL_NO_DISPLAY) return;
+
+    EGLSyncKHR sync = fences->create_sync(fences->display, EGL_SYNC_FENCE_KHR, NULL);
+    if (sync == EGL_NO_SYNC_KHR) return;
+
+    fences->fences[(fences->head + fences->count) % FRAME_FENCES_MAX] = sync;
+    fences->count++;
+    fences->frames++;
+}
@@ -0,0 +1,46 @@
+/*
+ * frame_fences.h
+ * Bounded render-ahead: an EGL_KHR_fence_sync fence is inserted after each
+ * frame's draw calls, and before a new frame is started the CPU waits for the
+ * oldest fence only if the configured number of frames is already in flight.
+ */
+
+#ifndef FRAME_FENCES_H
+#define FRAME_FENCES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#define FRAME_FENCES_MAX 3
+
+struct frame_fences {
+    EGLDisplay display;
+    PFNEGLCREATESYNCKHRPROC create_sync;
+    PFNEGLCLIENTWAITSYNCKHRPROC client_wait_sync;
+    PFNEGLDESTROYSYNCKHRPROC destroy_sync;
+
+    int limit;                      /* max frames in flight, 1..FRAME_FENCES_MAX */
+    EGLSyncKHR fences[FRAME_FENCES_MAX];
+    int head;                       /* index of the oldest fence */
+    int count;
+
+    uint64_t frames;                /* fences inserted */
+    uint64_t waits;                 /* times the CPU had to block */
+    uint64_t wait_ns;               /* total time blocked */
+    uint64_t max_wait_ns;
+};
+
+/* Returns false (and leaves the queue disabled) without EGL_KHR_fence_sync */
+bool frame_fences_init(struct frame_fences *fences, EGLDisplay display, int limit);
+void frame_fences_finish(struct frame_fences *fences);
+
+/* Before drawing: block on the oldest frame if limit frames are still in flight */
+void frame_fences_throttle(struct frame_fences *fences);
+
+/* After drawing, before eglSwapBuffers: mark the end of this frame's GPU work */
+void frame_fences_insert(struct frame_fences *fences);
+
+#endif /* FRAME_FENCES_H */
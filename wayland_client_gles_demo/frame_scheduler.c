@@ -0,0 +1,101 @@
+/*
+ * frame_scheduler.c
+ * Late-latching frame scheduler, see frame_scheduler.h.
+ */
+
+#include "frame_scheduler.h"
+
+#define MARGIN_MIN_NS       500000ull   /* 0.5 ms */
+#define MARGIN_INITIAL_NS   2000000ull  /* 2 ms */
+#define MARGIN_DECAY_SHIFT  5           /* shrink by 1/32 per met deadline */
+#define COST_DECAY_SHIFT    4           /* predicted cost follows drops at 1/16 */
+
+static uint64_t now_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void frame_scheduler_init(struct frame_scheduler *sched, clockid_t clock) {
+    *sched = (struct frame_scheduler){
+        .clock = clock,
+        .margin_ns = MARGIN_INITIAL_NS,
+    };
+}
+
+bool frame_scheduler_ready(const struct frame_scheduler *sched) {
+    return sched->refresh_ns != 0 && sched->vblank_ns != 0;
+}
+
+uint64_t frame_scheduler_plan(struct frame_scheduler *sched, uint64_t now) {
+    if (!frame_scheduler_ready(sched)) {
+        sched->target_ns = 0;
+        return 0;
+    }
+
+    uint64_t lead = sched->render_cost_ns + sched->margin_ns;
+
+    /* First vblank after the anchor whose latch point is not in the past */
+    uint64_t earliest = now + lead;
+    uint64_t deadline = sched->vblank_ns;
+    if (earliest > deadline) {
+        uint64_t cycles = (earliest - deadline + sched->refresh_ns - 1) / sched->refresh_ns;
+        deadline += cycles * sched->refresh_ns;
+    }
+
+    sched->target_ns = deadline;
+    return deadline - lead;
+}
+
+uint64_t frame_scheduler_queue(struct frame_scheduler *sched, uint64_t prev_target_ns, uint64_t now) {
+    if (frame_scheduler_plan(sched, now) == 0) return 0;
+
+    if (prev_target_ns && prev_target_ns + sched->refresh_ns > sched->target_ns)
+        sched->target_ns = prev_target_ns + sched->refresh_ns;
+    return sched->target_ns;
+}
+
+void frame_scheduler_set_refresh(struct frame_scheduler *sched, uint64_t refresh_ns) {
+    if (refresh_ns == 0 || refresh_ns == sched->refresh_ns) return;
+    sched->refresh_ns = refresh_ns;
+    sched->resync = true;
+}
+
+void frame_scheduler_begin_frame(struct frame_scheduler *sched) {
+    sched->frame_start_ns = now_ns(sched->clock);
+}
+
+void frame_scheduler_end_frame(struct frame_scheduler *sched) {
+    uint64_t cost = now_ns(sched->clock) - sched->frame_start_ns;
+
+    /* Jump up immediately on a slower frame, drift down slowly on faster ones */
+    if (cost >= sched->render_cost_ns)
+        sched->render_cost_ns = cost;
+    else
+        sched->render_cost_ns -= (sched->render_cost_ns - cost) >> COST_DECAY_SHIFT;
+}
+
+void frame_scheduler_presented(struct frame_scheduler *sched, uint64_t target_ns,
+                               uint64_t present_ns, uint64_t refresh_ns) {
+    if (refresh_ns) sched->refresh_ns = refresh_ns;
+    if (present_ns) sched->vblank_ns = present_ns;
+
+    /* Frames rendered before the scheduler was ready have no deadline to judge,
+       nor do frames aimed at the old output's vblank grid */
+    if (sched->resync) {
+        sched->resync = false;
+        return;
+    }
+    if (target_ns == 0 || sched->refresh_ns == 0) return;
+
+    if (present_ns > target_ns + sched->refresh_ns / 2) {
+        /* Missed: double the margin, but never beyond one refresh period */
+        sched->misses++;
+        sched->margin_ns *= 2;
+        if (sched->margin_ns > sched->refresh_ns) sched->margin_ns = sched->refresh_ns;
+    } else {
+        sched->hits++;
+        sched->margin_ns -= sched->margin_ns >> MARGIN_DECAY_SHIFT;
+        if (sched->margin_ns < MARGIN_MIN_NS) sched->margin_ns = MARGIN_MIN_NS;
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * frame_scheduler.h
+ * Late-latching frame scheduler.
+ *
+ * Predicts the next presentation (vblank) from presentation feedback and
+ * computes when each frame should start,
+ *     deadline - predicted render cost - safety margin
+ * so that animation state is sampled as late as possible; the caller waits
+ * for that time in its event loop. The margin grows
+ * after a deadline miss and decays back while deadlines are met.
+ *
+ * All times are nanoseconds on the scheduler clock, which must be the
+ * wp_presentation clock so that feedback timestamps can be compared.
+ */
+
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+struct frame_scheduler {
+    clockid_t clock;
+
+    uint64_t refresh_ns;        /* refresh period, 0 until feedback reports one */
+    uint64_t vblank_ns;         /* a known presentation time, anchors the vblank phase */
+
+    uint64_t render_cost_ns;    /* predicted render cost (fast attack, slow decay) */
+    uint64_t margin_ns;         /* adaptive safety margin */
+
+    bool resync;                /* refresh changed: next feedback re-anchors, no miss counted */
+
+    uint64_t target_ns;         /* presentation deadline of the frame being rendered */
+    uint64_t frame_start_ns;
+
+    uint64_t hits;
+    uint64_t misses;
+};
+
+void frame_scheduler_init(struct frame_scheduler *sched, clockid_t clock);
+
+/* True once a refresh period and vblank phase are known */
+bool frame_scheduler_ready(const struct frame_scheduler *sched);
+
+/*
+ * Pick the first deadline that can still be met from now and make it the
+ * target of the next frame. Returns the late latch (wake-up) time; 0 if the
+ * scheduler is not ready, meaning "render immediately".
+ */
+uint64_t frame_scheduler_plan(struct frame_scheduler *sched, uint64_t now_ns);
+
+/*
+ * Target for a frame queued behind frames already committed: one refresh
+ * after prev_target_ns, or the earliest reachable vblank if that is later.
+ * Becomes the target of the next frame; returns 0 if not ready.
+ */
+uint64_t frame_scheduler_queue(struct frame_scheduler *sched, uint64_t prev_target_ns, uint64_t now_ns);
+
+/*
+ * The surface moved to an output with a different refresh period. Predictions
+ * switch to it immediately; the vblank phase is re-learned from the next
+ * feedback without treating the transition as a missed deadline.
+ */
+void frame_scheduler_set_refresh(struct frame_scheduler *sched, uint64_t refresh_ns);
+
+/* Bracket the CPU side of a frame (draw + swap) to measure render cost */
+void frame_scheduler_begin_frame(struct frame_scheduler *sched);
+void frame_scheduler_end_frame(struct frame_scheduler *sched);
+
+/* Feed back when the frame aimed at target_ns was actually presented */
+void frame_scheduler_presented(struct frame_scheduler *sched, uint64_t target_ns,
+                               uint64_t present_ns, uint64_t refresh_ns);
+
+#endif /* FRAME_SCHEDULER_H */
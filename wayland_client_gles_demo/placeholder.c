@@ -0,0 +1,59 @@
+/*
+ * placeholder.c
+ * Solid-color first-frame buffer, see placeholder.h.
+ */
+
+#define _GNU_SOURCE
+
+#include "placeholder.h"
+
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <wayland-client.h>
+#include "single-pixel-buffer-v1-client-protocol.h"
+
+static uint8_t to_u8(float c) {
+    return (uint8_t)(c * 255.0f + 0.5f);
+}
+
+static struct wl_buffer *shm_buffer_create(struct wl_shm *shm, int width, int height, float r, float g, float b) {
+    int stride = width * 4;
+    size_t size = (size_t)stride * height;
+    int fd = memfd_create("placeholder", MFD_CLOEXEC);
+    if (fd < 0) return NULL;
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        return NULL;
+    }
+    uint32_t *pixels = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (pixels == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    uint32_t pixel = 0xff000000u | (uint32_t)to_u8(r) << 16 | (uint32_t)to_u8(g) << 8 | to_u8(b);
+    for (size_t i = 0; i < size / 4; i++) pixels[i] = pixel;
+    munmap(pixels, size);
+
+    /* The pool keeps the memory alive for the buffer */
+    struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, (int32_t)size);
+    struct wl_buffer *buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_XRGB8888);
+    wl_shm_pool_destroy(pool);
+    close(fd);
+    return buffer;
+}
+
+struct wl_buffer *placeholder_buffer_create(struct wp_single_pixel_buffer_manager_v1 *single_pixel,
+                                            struct wl_shm *shm, int width, int height,
+                                            float r, float g, float b, bool *used_single_pixel) {
+    *used_single_pixel = single_pixel && width == 1 && height == 1;
+    if (*used_single_pixel) {
+        /* Channels are premultiplied 32-bit fractions of 1.0 */
+        return wp_single_pixel_buffer_manager_v1_create_u32_rgba_buffer(single_pixel,
+                (uint32_t)((double)r * UINT32_MAX), (uint32_t)((double)g * UINT32_MAX),
+                (uint32_t)((double)b * UINT32_MAX), UINT32_MAX);
+    }
+    if (!shm) return NULL;
+    return shm_buffer_create(shm, width, height, r, g, b);
+}
@@ -0,0 +1,29 @@
+/*
+ * placeholder.h
+ * Solid-color buffer for the first commit, before EGL can render.
+ *
+ * A wp_single_pixel_buffer_v1 buffer needs no memory on the client side at
+ * all; the wl_shm fallback is a memfd holding XRGB8888 pixels. Either way
+ * the buffer is 1x1 when the caller stretches it with wp_viewport, and the
+ * full window size otherwise.
+ */
+
+#ifndef PLACEHOLDER_H
+#define PLACEHOLDER_H
+
+#include <stdbool.h>
+
+struct wl_buffer;
+struct wl_shm;
+struct wp_single_pixel_buffer_manager_v1;
+
+/*
+ * width x height buffer of opaque color r, g, b (0..1). The single-pixel
+ * manager is used for 1x1 buffers when available. NULL on failure; the
+ * buffer may be destroyed once a later commit replaced it.
+ */
+struct wl_buffer *placeholder_buffer_create(struct wp_single_pixel_buffer_manager_v1 *single_pixel,
+                                            struct wl_shm *shm, int width, int height,
+                                            float r, float g, float b, bool *used_single_pixel);
+
+#endif /* PLACEHOLDER_H */
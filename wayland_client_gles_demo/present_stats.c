@@ -0,0 +1,99 @@
+/*
+ * present_stats.c
+ * Presentation feedback bookkeeping, see present_stats.h.
+ */
+
+#include "present_stats.h"
+
+#include <string.h>
+
+#include "presentation-time-client-protocol.h"
+
+void present_stats_reset(struct present_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->latency_min_ns = UINT64_MAX;
+}
+
+void present_stats_clear_counters(struct present_stats *stats) {
+    stats->presented = 0;
+    stats->discarded = 0;
+    stats->missed = 0;
+    stats->latency_min_ns = UINT64_MAX;
+    stats->latency_max_ns = 0;
+    stats->latency_sum_ns = 0;
+}
+
+/* Refresh cycles between the previous and this presented frame that showed nothing new */
+static uint64_t count_missed(const struct present_stats *stats, const struct present_sample *sample) {
+    if (stats->last_present_ns == 0) return 0;
+
+    if ((sample->flags & WP_PRESENTATION_FEEDBACK_KIND_VSYNC) && sample->seq != 0 && stats->last_seq != 0) {
+        if (sample->seq > stats->last_seq + 1) return sample->seq - stats->last_seq - 1;
+        return 0;
+    }
+
+    /* No usable retrace counter: estimate from the timestamps */
+    if (sample->refresh_ns == 0 || sample->present_ns <= stats->last_present_ns) return 0;
+    uint64_t delta = sample->present_ns - stats->last_present_ns;
+    uint64_t cycles = (delta + sample->refresh_ns / 2) / sample->refresh_ns;
+    return cycles > 1 ? cycles - 1 : 0;
+}
+
+void present_stats_add(struct present_stats *stats, const struct present_sample *sample) {
+    stats->history[stats->history_head] = *sample;
+    stats->history_head = (stats->history_head + 1) % PRESENT_STATS_HISTORY;
+    if (stats->history_len < PRESENT_STATS_HISTORY) stats->history_len++;
+
+    if (!sample->presented) {
+        stats->discarded++;
+        return;
+    }
+
+    stats->presented++;
+    stats->missed += count_missed(stats, sample);
+
+    if (sample->present_ns >= sample->commit_ns) {
+        uint64_t latency = sample->present_ns - sample->commit_ns;
+        if (latency < stats->latency_min_ns) stats->latency_min_ns = latency;
+        if (latency > stats->latency_max_ns) stats->latency_max_ns = latency;
+        stats->latency_sum_ns += latency;
+    }
+
+    if (sample->refresh_ns) stats->refresh_ns = sample->refresh_ns;
+    stats->last_seq = sample->seq;
+    stats->last_present_ns = sample->present_ns;
+}
+
+uint32_t present_stats_recent(const struct present_stats *stats, struct present_sample *out, uint32_t max) {
+    uint32_t n = stats->history_len < max ? stats->history_len : max;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t idx = (stats->history_head + PRESENT_STATS_HISTORY - 1 - i) % PRESENT_STATS_HISTORY;
+        out[i] = stats->history[idx];
+    }
+    return n;
+}
+
+double present_stats_latency_avg_ms(const struct present_stats *stats) {
+    if (stats->presented == 0) return 0.0;
+    return (double)stats->latency_sum_ns / stats->presented / 1e6;
+}
+
+void present_stats_print(const struct present_stats *stats, const char *label, FILE *out) {
+    double refresh_hz = stats->refresh_ns ? 1e9 / stats->refresh_ns : 0.0;
+
+    if (stats->presented == 0) {
+        fprintf(out, "%s: presented 0, discarded %llu\n", label, (unsigned long long)stats->discarded);
+        return;
+    }
+    fprintf(out, "%s: presented %llu, discarded %llu, missed %llu, "
+            "latency avg %.2f ms (min %.2f, max %.2f), refresh %.2f Hz, seq %llu\n",
+            label,
+            (unsigned long long)stats->presented,
+            (unsigned long long)stats->discarded,
+            (unsigned long long)stats->missed,
+            present_stats_latency_avg_ms(stats),
+            stats->latency_min_ns / 1e6,
+            stats->latency_max_ns / 1e6,
+            refresh_hz,
+            (unsigned long long)stats->last_seq);
+}
@@ -0,0 +1,61 @@
+/*
+ * present_stats.h
+ * Accumulates wp_presentation feedback into per-frame samples and
+ * aggregate latency / missed-frame statistics.
+ *
+ * All timestamps are nanoseconds in the presentation clock domain
+ * (wp_presentation.clock_id), so commit and present times are comparable.
+ */
+
+#ifndef PRESENT_STATS_H
+#define PRESENT_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define PRESENT_STATS_HISTORY 128
+
+/* One committed frame and what the compositor did with it */
+struct present_sample {
+    uint64_t commit_ns;     /* when the frame was committed */
+    uint64_t present_ns;    /* when it turned into light (0 if discarded) */
+    uint64_t refresh_ns;    /* output refresh interval, 0 if unknown */
+    uint64_t seq;           /* vertical retrace counter, 0 if unknown */
+    uint32_t flags;         /* wp_presentation_feedback_kind bits */
+    bool presented;
+};
+
+struct present_stats {
+    uint64_t presented;
+    uint64_t discarded;
+    uint64_t missed;        /* refresh cycles skipped between two presented frames */
+
+    uint64_t latency_min_ns;
+    uint64_t latency_max_ns;
+    uint64_t latency_sum_ns;
+
+    uint64_t refresh_ns;    /* last refresh interval reported */
+    uint64_t last_seq;
+    uint64_t last_present_ns;
+
+    /* ring of the most recent samples, oldest overwritten first */
+    struct present_sample history[PRESENT_STATS_HISTORY];
+    uint32_t history_len;
+    uint32_t history_head;
+};
+
+void present_stats_reset(struct present_stats *stats);
+/* Zero the counters but keep sequence continuity and history, for per-interval stats */
+void present_stats_clear_counters(struct present_stats *stats);
+void present_stats_add(struct present_stats *stats, const struct present_sample *sample);
+
+/* Copy up to max of the most recent samples, newest first; returns the count */
+uint32_t present_stats_recent(const struct present_stats *stats, struct present_sample *out, uint32_t max);
+
+double present_stats_latency_avg_ms(const struct present_stats *stats);
+
+/* One-line human readable summary, prefixed with label */
+void present_stats_print(const struct present_stats *stats, const char *label, FILE *out);
+
+#endif /* PRESENT_STATS_H */
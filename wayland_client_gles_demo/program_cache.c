@@ -0,0 +1,203 @@
+/*
+ * program_cache.c
+ * GL program binary cache, see program_cache.h.
+ */
+
+#include "program_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <EGL/egl.h>
+
+#include "egl_util.h"
+
+#define CACHE_SUBDIR "wayland_client_gles_demo"
+#define CACHE_MAGIC 0x50444357u   /* "WCDP" */
+#define CACHE_MAX_BINARY (16u << 20)  /* far above any real program; guards corrupt entries */
+
+struct cache_header {
+    uint32_t magic;
+    uint32_t format;
+    uint32_t length;
+};
+
+/* FNV-1a, continuing from hash; includes the terminating NUL so fields cannot run together */
+static uint64_t hash_string(uint64_t hash, const char *s) {
+    do {
+        hash ^= (uint8_t)*s;
+        hash *= 0x100000001b3ull;
+    } while (*s++);
+    return hash;
+}
+
+/* mkdir -p */
+static bool make_dirs(char *path) {
+    for (char *p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        bool ok = mkdir(path, 0755) == 0 || errno == EEXIST;
+        *p = '/';
+        if (!ok) return false;
+    }
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+void program_cache_init(struct program_cache *cache) {
+    memset(cache, 0, sizeof(*cache));
+
+    const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+    if (!egl_has_extension(extensions, "GL_OES_get_program_binary")) return;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+    if (formats <= 0) return;
+
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    int n;
+    if (xdg && xdg[0] == '/') n = snprintf(cache->dir, sizeof(cache->dir), "%s/" CACHE_SUBDIR, xdg);
+    else if (home) n = snprintf(cache->dir, sizeof(cache->dir), "%s/.cache/" CACHE_SUBDIR, home);
+    else return;
+    if (n < 0 || (size_t)n >= sizeof(cache->dir) || !make_dirs(cache->dir)) return;
+
+    cache->get_program_binary = (PFNGLGETPROGRAMBINARYOESPROC)eglGetProcAddress("glGetProgramBinaryOES");
+    cache->program_binary = (PFNGLPROGRAMBINARYOESPROC)eglGetProcAddress("glProgramBinaryOES");
+    if (!cache->get_program_binary || !cache->program_binary) return;
+
+    cache->driver_hash = hash_string(0xcbf29ce484222325ull, (const char *)glGetString(GL_RENDERER));
+    cache->driver_hash = hash_string(cache->driver_hash, (const char *)glGetString(GL_VERSION));
+    cache->enabled = true;
+}
+
+static bool program_linked(GLuint program) {
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return linked == GL_TRUE;
+}
+
+static GLuint compile_shader(GLenum type, const char *src) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &src, NULL);
+    glCompileShader(shader);
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        char log[512];
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        fprintf(stderr, "Shader compile failed: %s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static GLuint link_program(const char *vertex_src, const char *fragment_src, const char *const *attribs) {
+    GLuint vs = compile_shader(GL_VERTEX_SHADER, vertex_src);
+    GLuint fs = compile_shader(GL_FRAGMENT_SHADER, fragment_src);
+    if (!vs || !fs) {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    for (GLuint i = 0; attribs && attribs[i]; i++) glBindAttribLocation(program, i, attribs[i]);
+    glLinkProgram(program);
+    /* The program keeps what it needs; the shaders go away with it */
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    if (!program_linked(program)) {
+        char log[512];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        fprintf(stderr, "Program link failed: %s\n", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+/* Cached binary loaded into a new program, 0 if absent or rejected */
+static GLuint load_binary(struct program_cache *cache, const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+
+    struct cache_header header;
+    struct stat st;
+    void *binary = NULL;
+    GLuint program = 0;
+    /* The length comes from disk: it must be exactly what follows the header, before allocating */
+    if (fstat(fd, &st) == 0 &&
+        read(fd, &header, sizeof(header)) == sizeof(header) && header.magic == CACHE_MAGIC &&
+        header.length > 0 && header.length <= CACHE_MAX_BINARY &&
+        (off_t)header.length == st.st_size - (off_t)sizeof(header) &&
+        (binary = malloc(header.length)) &&
+        read(fd, binary, header.length) == (ssize_t)header.length) {
+        program = glCreateProgram();
+        cache->program_binary(program, header.format, binary, header.length);
+        if (!program_linked(program)) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    free(binary);
+    close(fd);
+    return program;
+}
+
+static void store_binary(struct program_cache *cache, GLuint program, const char *path) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0) return;
+    void *binary = malloc(length);
+    if (!binary) return;
+
+    struct cache_header header = { .magic = CACHE_MAGIC, .length = (uint32_t)length };
+    GLenum format = 0;
+    cache->get_program_binary(program, length, NULL, &format, binary);
+    header.format = format;
+
+    /* Temporary name unique per process, renamed over the final one */
+    char tmp[PATH_MAX + 32];
+    int n = snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+    int fd = n >= 0 && (size_t)n < sizeof(tmp) ? open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+    if (fd >= 0) {
+        bool ok = write(fd, &header, sizeof(header)) == sizeof(header) &&
+                  write(fd, binary, length) == length;
+        ok = close(fd) == 0 && ok;
+        if (!ok || rename(tmp, path) < 0) unlink(tmp);
+    }
+    free(binary);
+}
+
+GLuint program_cache_build(struct program_cache *cache, const char *vertex_src,
+                           const char *fragment_src, const char *const *attribs) {
+    if (!cache->enabled) return link_program(vertex_src, fragment_src, attribs);
+
+    /* Attribute bindings are baked into the binary, so they are part of the key too */
+    uint64_t key = hash_string(cache->driver_hash, vertex_src);
+    key = hash_string(key, fragment_src);
+    for (int i = 0; attribs && attribs[i]; i++) key = hash_string(key, attribs[i]);
+    char path[PATH_MAX];
+    int n = snprintf(path, sizeof(path), "%s/%016llx.bin", cache->dir, (unsigned long long)key);
+    /* A cache directory too deep for the file name: build without the cache */
+    if (n < 0 || (size_t)n >= sizeof(path)) return link_program(vertex_src, fragment_src, attribs);
+
+    GLuint program = load_binary(cache, path);
+    if (program) {
+        cache->hits++;
+        return program;
+    }
+
+    cache->misses++;
+    program = link_program(vertex_src, fragment_src, attribs);
+    if (program) store_binary(cache, program, path);
+    return program;
+}
@@ -0,0 +1,44 @@
+/*
+ * program_cache.h
+ * On-disk cache of linked GL programs through GL_OES_get_program_binary.
+ *
+ * One file per program under $XDG_CACHE_HOME/wayland_client_gles_demo
+ * (~/.cache without it), named by a hash of GL_RENDERER, GL_VERSION and the
+ * shader sources: a driver update or an edited shader misses the cache
+ * instead of loading a stale binary. A binary the driver still rejects is
+ * rebuilt from source and rewritten. Files are written under a temporary
+ * name and renamed into place, so readers never see a partial file.
+ */
+
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+struct program_cache {
+    bool enabled;               /* extension and at least one binary format available */
+    char dir[PATH_MAX];
+    uint64_t driver_hash;       /* GL_RENDERER + GL_VERSION */
+    PFNGLGETPROGRAMBINARYOESPROC get_program_binary;
+    PFNGLPROGRAMBINARYOESPROC program_binary;
+
+    uint32_t hits;
+    uint32_t misses;
+};
+
+/* Needs a current context; without the extension every build compiles from source */
+void program_cache_init(struct program_cache *cache);
+
+/*
+ * Linked program for the sources, with the NULL-terminated attribute names
+ * bound to locations 0, 1, ... Loaded from the cache when possible, compiled
+ * and stored otherwise. Returns 0 on compile or link failure.
+ */
+GLuint program_cache_build(struct program_cache *cache, const char *vertex_src,
+                           const char *fragment_src, const char *const *attribs);
+
+#endif /* PROGRAM_CACHE_H */
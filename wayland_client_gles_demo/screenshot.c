@@ -0,0 +1,44 @@
+/*
+ * screenshot.c
+ * Framebuffer readback into PPM, see screenshot.h.
+ */
+
+#include "screenshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GLES2/gl2.h>
+
+uint8_t *screenshot_read_ppm(int width, int height, size_t *size) {
+    char header[32];
+    int header_len = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+    size_t row = (size_t)width * 3;
+
+    /* GLES2 only guarantees RGBA / UNSIGNED_BYTE for readback */
+    uint8_t *rgba = malloc((size_t)width * height * 4);
+    uint8_t *ppm = malloc(header_len + row * height);
+    if (!rgba || !ppm) {
+        free(rgba);
+        free(ppm);
+        return NULL;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+
+    memcpy(ppm, header, header_len);
+    for (int y = 0; y < height; y++) {
+        /* GL rows start at the bottom */
+        const uint8_t *src = rgba + (size_t)(height - 1 - y) * width * 4;
+        uint8_t *dst = ppm + header_len + (size_t)y * row;
+        for (int x = 0; x < width; x++) {
+            dst[x * 3 + 0] = src[x * 4 + 0];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4 + 2];
+        }
+    }
+    free(rgba);
+    *size = header_len + row * height;
+    return ppm;
+}
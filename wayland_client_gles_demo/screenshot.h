@@ -0,0 +1,19 @@
+/*
+ * screenshot.h
+ * Read back the current GL framebuffer as a binary PPM image.
+ */
+
+#ifndef SCREENSHOT_H
+#define SCREENSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * glReadPixels the width x height framebuffer into a malloc'ed P6 PPM,
+ * top row first. Returns NULL on allocation failure; *size receives the
+ * file size.
+ */
+uint8_t *screenshot_read_ppm(int width, int height, size_t *size);
+
+#endif /* SCREENSHOT_H */
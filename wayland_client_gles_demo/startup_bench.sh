@@ -0,0 +1,47 @@
+#!/bin/sh
+# startup_bench.sh BINARY [RUNS] [-- CLIENT OPTIONS]
+# Start the client RUNS times (default 20), each exiting after its first
+# frame, and print percentiles of the startup milestones and of every phase
+# (thread:phase) from the --startup-report JSON, in milliseconds.
+# Needs a running Wayland compositor. The first run may include a cold
+# program cache.
+set -e
+
+bin=${1:?usage: startup_bench.sh BINARY [RUNS] [-- CLIENT OPTIONS]}
+shift
+runs=20
+if [ $# -gt 0 ] && [ "$1" != "--" ]; then
+    runs=$1
+    shift
+fi
+if [ "${1:-}" = "--" ]; then
+    shift
+fi
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+i=1
+while [ "$i" -le "$runs" ]; do
+    if ! "$bin" --exit-after-first-frame --stats-interval=0 --startup-report="$dir/run-$i.json" "$@" \
+            >/dev/null 2>"$dir/run-$i.log"; then
+        echo "run $i failed:" >&2
+        cat "$dir/run-$i.log" >&2
+        exit 1
+    fi
+    i=$((i + 1))
+done
+
+echo "$runs runs"
+for f in "$dir"/run-*.json; do
+    sed -n -e 's/^  "\([a-z_]*\)_ms": \([0-9.]*\),$/\1 \2/p' \
+           -e 's/.*"name": "\([a-z_]*\)", "thread": "\([a-z]*\)", "start_ms": [0-9.]*, "duration_ms": \([0-9.]*\).*/\2:\1 \3/p' "$f"
+done | sort -k1,1 -k2,2n | awk '
+    # nearest-rank percentile of the sorted values v[1..n]
+    function pct(p,    i) { i = int(p * n); if (i < p * n) i++; if (i < 1) i = 1; return v[i] }
+    function flush() { if (n) printf "%-24s %8.2f %8.2f %8.2f %8.2f\n", key, pct(0.5), pct(0.9), pct(0.99), v[n] }
+    BEGIN { printf "%-24s %8s %8s %8s %8s\n", "ms", "p50", "p90", "p99", "max" }
+    $1 != key { flush(); key = $1; n = 0 }
+    { v[++n] = $2 }
+    END { flush() }
+'
@@ -0,0 +1,68 @@
+/*
+ * startup_profile.c
+ * Startup phase timings, see startup_profile.h.
+ */
+
+#include "startup_profile.h"
+
+#include <string.h>
+#include <time.h>
+
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void startup_profile_init(struct startup_profile *profile) {
+    memset(profile->phases, 0, sizeof(profile->phases));
+    atomic_store(&profile->count, 0);
+    profile->origin_ns = monotonic_ns();
+}
+
+int startup_profile_begin(struct startup_profile *profile, const char *name, const char *thread) {
+    int slot = atomic_fetch_add(&profile->count, 1);
+    if (slot >= STARTUP_PROFILE_MAX) return -1;
+    profile->phases[slot].name = name;
+    profile->phases[slot].thread = thread;
+    profile->phases[slot].begin_ns = monotonic_ns();
+    return slot;
+}
+
+void startup_profile_end(struct startup_profile *profile, int slot) {
+    if (slot >= 0 && slot < STARTUP_PROFILE_MAX) profile->phases[slot].end_ns = monotonic_ns();
+}
+
+double startup_profile_ms(const struct startup_profile *profile, uint64_t ns) {
+    return ns > profile->origin_ns ? (ns - profile->origin_ns) / 1e6 : 0.0;
+}
+
+void startup_profile_write_json(const struct startup_profile *profile, FILE *out,
+                                const char *const *milestone_names, const double *milestone_ms) {
+    int count = atomic_load(&profile->count);
+    if (count > STARTUP_PROFILE_MAX) count = STARTUP_PROFILE_MAX;
+
+    /* Slots are in claim order; print by start time so threads interleave correctly */
+    int order[STARTUP_PROFILE_MAX];
+    for (int i = 0; i < count; i++) {
+        int j = i;
+        while (j > 0 && profile->phases[order[j - 1]].begin_ns > profile->phases[i].begin_ns) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    fprintf(out, "{\n");
+    for (int i = 0; milestone_names && milestone_names[i]; i++)
+        fprintf(out, "  \"%s_ms\": %.3f,\n", milestone_names[i], milestone_ms[i]);
+    fprintf(out, "  \"phases\": [\n");
+    for (int i = 0; i < count; i++) {
+        const struct startup_phase_time *phase = &profile->phases[order[i]];
+        uint64_t end = phase->end_ns ? phase->end_ns : phase->begin_ns;
+        fprintf(out, "    { \"name\": \"%s\", \"thread\": \"%s\", \"start_ms\": %.3f, \"duration_ms\": %.3f }%s\n",
+                phase->name, phase->thread, startup_profile_ms(profile, phase->begin_ns),
+                (end - phase->begin_ns) / 1e6, i + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
@@ -0,0 +1,51 @@
+/*
+ * startup_profile.h
+ * Startup phase timings for time-to-first-frame analysis.
+ *
+ * Phases are CLOCK_MONOTONIC intervals relative to the profile origin (taken
+ * before connecting), tagged with the thread that ran them; phases on
+ * different threads may overlap. Slots are claimed atomically so a worker
+ * can record while the main thread does; readers must synchronize with the
+ * workers first (e.g. join them).
+ */
+
+#ifndef STARTUP_PROFILE_H
+#define STARTUP_PROFILE_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define STARTUP_PROFILE_MAX 32
+
+struct startup_phase_time {
+    const char *name;
+    const char *thread;
+    uint64_t begin_ns;
+    uint64_t end_ns;            /* 0 while running */
+};
+
+struct startup_profile {
+    uint64_t origin_ns;
+    struct startup_phase_time phases[STARTUP_PROFILE_MAX];
+    atomic_int count;
+};
+
+/* Reset and take the origin now */
+void startup_profile_init(struct startup_profile *profile);
+
+/* Start a phase; returns its slot for startup_profile_end(), -1 if full */
+int startup_profile_begin(struct startup_profile *profile, const char *name, const char *thread);
+void startup_profile_end(struct startup_profile *profile, int slot);
+
+/* Milliseconds since the origin */
+double startup_profile_ms(const struct startup_profile *profile, uint64_t ns);
+
+/*
+ * JSON object with the phases in start order, one per line, plus the
+ * given milestones (name/value pairs in ms, NULL-terminated names).
+ */
+void startup_profile_write_json(const struct startup_profile *profile, FILE *out,
+                                const char *const *milestone_names, const double *milestone_ms);
+
+#endif /* STARTUP_PROFILE_H */